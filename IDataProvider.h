@@ -4,11 +4,14 @@
 //#include "IEventCounters.h"
 #include "LibraryType.h"
 #include <chrono>
+#include <cstdint>
 #include <map>
+#include <memory>
 #include <ostream>
 #include <string>
 #include <utility>
 using namespace std;
+class TrapRecord;
 typedef chrono::time_point<chrono::system_clock, chrono::milliseconds> Timestamp;
 namespace EventDataProvider {
     enum DataType {
@@ -43,8 +46,10 @@ namespace EventDataProvider {
 
     struct Data {
     public:
-        explicit Data( EventDataProvider::DataType data_type, string message = string(), string src_ip = string() )
-                : data_type( data_type ), message( std::move( message ) ), source_ip( std::move( src_ip ) ) {
+        explicit Data( EventDataProvider::DataType data_type, string message = string(), string src_ip = string(),
+                       std::shared_ptr<const TrapRecord> record = nullptr )
+                : data_type( data_type ), message( std::move( message ) ), source_ip( std::move( src_ip ) ),
+                  record( std::move( record ) ) {
             // TODO fix received timestamp here! to be more precise!
             //            m_receivedTimestamp = chrono::system_clock::now();
             //        counters->events_received++;
@@ -59,9 +64,13 @@ namespace EventDataProvider {
 
         const string &GetSourceIPAddress() const { return source_ip; }
 
-        EventDataProvider::DataType data_type;
-        const string                message;
-        const string                source_ip;
+        /** Decoded trap, set when the provider is asked to deliver records. */
+        const std::shared_ptr<const TrapRecord> &GetRecord() const { return record; }
+
+        EventDataProvider::DataType             data_type;
+        const string                            message;
+        const string                            source_ip;
+        const std::shared_ptr<const TrapRecord> record;
     };
     class Listener {
     public:
@@ -90,6 +99,13 @@ public:
      */
     //virtual void UpdateStatistics() = 0;
 
+    typedef std::map<std::string, uint64_t> Statistics;
+    /** counters of what the provider did so far, by name; safe to call while Run is receiving
+     *
+     * @return empty if the provider keeps none
+     */
+    virtual Statistics GetStatistics() const { return {}; }
+
     /** finalise - close files , sockets etc
      *
      * @return
@@ -2,6 +2,7 @@
 #include <memory>
 
 #include "TrapDataProvider.h"
+#include "snmp_probes.h"
 #include <boost/bind/bind.hpp>
 
 extern "C" IDataProvider *
@@ -14,16 +15,20 @@ TrapDataUdpDP::TrapDataUdpDP(){
 
 
 TrapDataUdpDP::~TrapDataUdpDP() {
-    if ( m_TapOutput.is_open() ) {
-        m_TapOutput.flush();
-        m_TapOutput.close();
-    }
+    stopStatsDump();
 }
 
-void TrapDataUdpDP::ReportMessage( string &Timestamp, string &IpAddress, string &Message ) {
-    if ( m_DoTap ) {
+void TrapDataUdpDP::ReportMessage( string &Timestamp, string &IpAddress, string &Message, string &ClientIpAddress,
+                                   std::shared_ptr<const TrapRecord> record ) {
+    if ( m_DoTap && !Message.empty() ) {
         tapMessage( Timestamp, IpAddress, Message );
     }
+    if ( m_DataListener ) {
+        m_Counters.Add( OUTPUT_BYTES, Message.size() );
+        SNMP_PROBE3( sink_write, "listener", 1, Message.size() );
+        m_DataListener->OnDataProviderEvent(
+                EventDataProvider::Data( EventDataProvider::DATA, Message, ClientIpAddress, std::move( record ) ) );
+    }
 }
 
 bool TrapDataUdpDP::Run() {
@@ -32,15 +37,50 @@ bool TrapDataUdpDP::Run() {
         // Construct a signal set registered for process termination.
         boost::asio::signal_set signals( io_service, SIGINT, SIGTERM );
         signals.async_wait( boost::bind( &boost::asio::io_service::stop, &io_service ) );
+        udp::endpoint endpoint;
         if ( m_BindIPAddress == "0.0.0.0" ) {
             // bind to all interfaces
-            m_Socket = std::make_shared<udp::socket>( io_service, udp::endpoint( boost::asio::ip::udp::v4(), m_Port ) );
+            endpoint = udp::endpoint( boost::asio::ip::udp::v4(), m_Port );
             //MLOG( INFO ) << "Listening  all interfaces on port " << m_Port;
         } else {
-            m_Socket = std::make_shared<udp::socket>( io_service,
-                                                      udp::endpoint( boost::asio::ip::address::from_string( m_BindIPAddress ), m_Port ) );
+            endpoint = udp::endpoint( boost::asio::ip::address::from_string( m_BindIPAddress ), m_Port );
             //MLOG( INFO ) << "Listening " << m_BindIPAddress << ":" << m_Port;
         }
+        m_Socket = std::make_shared<udp::socket>( io_service, endpoint.protocol() );
+        // filter before binding so that nothing is queued unfiltered
+        if ( !m_SocketFilter.empty() ) {
+            int err = AttachSocketFilter( m_Socket->native_handle(), m_SocketFilter );
+            if ( err ) {
+                //MLOG( ERROR ) << "Could not attach socket filter: " << strerror( err );
+                return false;
+            }
+        }
+        if ( m_ReceiveBuffer.Apply( m_Socket->native_handle(), m_ReceiveBufferSize, m_ReceiveBufferMaxSize,
+                                    !m_SocketFilter.empty() ) != 0 ) {
+            //MLOG( ERROR ) << "Could not size the receive buffer";
+            return false;
+        }
+        m_Socket->bind( endpoint );
+        if ( m_MeasureLatency || m_TimestampReceived ) {
+            // without it only the stages after the read are timed, and traps get the processing time
+            int on = 1;
+            setsockopt( m_Socket->native_handle(), SOL_SOCKET, SO_TIMESTAMPNS, &on, sizeof( on ) );
+        }
+        {
+            // the address each trap was sent to, for the transport info
+            int on = 1;
+            if ( endpoint.protocol() == udp::v6() ) {
+                setsockopt( m_Socket->native_handle(), IPPROTO_IPV6, IPV6_RECVPKTINFO, &on, sizeof( on ) );
+            }
+            setsockopt( m_Socket->native_handle(), IPPROTO_IP, IP_PKTINFO, &on, sizeof( on ) );
+        }
+        if ( m_UseGro ) {
+            // an optimisation only: without it every datagram just arrives on its own
+            int on = 1;
+            setsockopt( m_Socket->native_handle(), SOL_UDP, UDP_GRO, &on, sizeof( on ) );
+        }
+        m_ReceivedAtOpen = m_Counters.Read( DATAGRAMS_RECEIVED );
+        m_SocketFd       = m_Socket->native_handle();
     } catch ( exception &ex ) {
         //MLOG( ERROR ) << ex.what();
         return false;
@@ -48,46 +88,231 @@ bool TrapDataUdpDP::Run() {
        // MLOG( ERROR ) << "Unhandled exception";
         return false;
     }
-    boost::system::error_code      error;
-    udp::endpoint                  remote_endpoint;
-    boost::array<u_char, 100 * 1024> recv_buf{};
-    while ( !m_Interrupted ) {
+    startStatsDump();
+    bool received = false;
+    if ( m_ReceiveBackend == "io_uring" ) {
+        received = receiveUring();
+    }
+    if ( !received ) {
+        receiveAsio();
+    }
+
+        //MLOG( DEBUG ) << "Socket loop interrupted...";
+        if ( m_ColumnarSink ) {
+            m_ColumnarSink->Flush();
+        }
+        stopStatsDump();
+        boost::system::error_code error;
+        if ( m_Socket.get() ) {
+            m_SocketFd = -1;
+           // MLOG( DEBUG ) << "Shutdown socket...";
+            m_Socket->shutdown( boost::asio::socket_base::shutdown_receive, error );
+            m_Socket->close();
+            //MLOG( DEBUG ) << "Shutdown socket done";
+        }
+
+        return true;
+    }
+
+    /* Blocking recvmsg on the asio socket, which also brings the ancillary data. */
+    void TrapDataUdpDP::receiveAsio() {
+        udp::endpoint                    remote_endpoint;
+        boost::array<u_char, 100 * 1024> recv_buf{};
+        alignas( cmsghdr ) u_char        control[DatagramControl::SPACE];
+        while ( !m_Interrupted ) {
 
-        //        LOG(TRACE) << "Awaiting for data";
-        size_t len = m_Socket->receive_from( boost::asio::buffer( recv_buf ), remote_endpoint, 0, error );
+            //        LOG(TRACE) << "Awaiting for data";
+            iovec  iov{ recv_buf.c_array(), recv_buf.size() };
+            msghdr msg{};
+            msg.msg_name       = remote_endpoint.data();
+            msg.msg_namelen    = remote_endpoint.capacity();
+            msg.msg_iov        = &iov;
+            msg.msg_iovlen     = 1;
+            msg.msg_control    = control;
+            msg.msg_controllen = sizeof( control );
+            ssize_t len        = recvmsg( m_Socket->native_handle(), &msg, 0 );
 
-        if ( error && error != boost::asio::error::message_size ) {
-           // MLOG( FATAL ) << error.category().name() << ": " << error.value();
-            if ( m_ExitOnError ) {
+            if ( len < 0 ) {
+               // MLOG( FATAL ) << "recvmsg: " << strerror( errno );
+                if ( m_ExitOnError && errno != EINTR ) {
+                    break;
+                };
+                continue;
+            }
+            if ( m_Interrupted ) {
                 break;
-            };
-            continue;
+            }
+            if ( msg.msg_flags & MSG_TRUNC ) {
+                m_Counters.Add( DATAGRAMS_TRUNCATED );
+                continue;
+            }
+            remote_endpoint.resize( msg.msg_namelen );
+            handleReceived( recv_buf.c_array(), len, remote_endpoint, DatagramControl::Parse( msg ) );
         }
+    }
 
-        std::string timestamp = AddTimestamp();
+    /*
+     * Returns false if io_uring cannot be set up, or the kernel lacks
+     * multishot recvmsg, before anything was received, so that the caller
+     * can fall back to receiveAsio.
+     */
+    bool TrapDataUdpDP::receiveUring() {
+        UringReceiver receiver( m_UringBuffers, m_UringBufferSize, DatagramControl::SPACE );
+        if ( receiver.Start( m_Socket->native_handle() ) ) {
+            //MLOG( WARNING ) << "io_uring receive unavailable, using asio";
+            return false;
+        }
+        std::vector<UringReceiver::Datagram> batch;
+        udp::endpoint                        remote_endpoint;
+        while ( !m_Interrupted ) {
+            int error = receiver.Wait( batch );
+            if ( error == EOPNOTSUPP ) {
+                //MLOG( WARNING ) << "io_uring multishot receive unsupported, using asio";
+                return false;
+            }
+            if ( error ) {
+                if ( m_ExitOnError ) {
+                    break;
+                }
+                continue;
+            }
+            for ( const auto &datagram : batch ) {
+                if ( datagram.source_len > remote_endpoint.capacity() ) {
+                    continue;
+                }
+                if ( datagram.truncated ) {
+                    // only receive.io_uring.buffer_size was kept, too little to decode
+                    m_Counters.Add( DATAGRAMS_TRUNCATED );
+                    continue;
+                }
+                memcpy( remote_endpoint.data(), datagram.source, datagram.source_len );
+                remote_endpoint.resize( datagram.source_len );
+                handleReceived( datagram.data, datagram.length, remote_endpoint,
+                                DatagramControl::Parse( datagram.control ) );
+            }
+            receiver.Release();
+        }
+        return true;
+    }
 
-        u_char* data = recv_buf.c_array();
+    /*
+     * Splits what UDP_GRO coalesced back into the datagrams sent, in place,
+     * after letting the receive buffer see the kernel's drop count.  The
+     * socket filter only saw the first of them, so the others go through
+     * its checks here.
+     */
+    void TrapDataUdpDP::handleReceived( u_char *data, size_t len, const udp::endpoint &remote_endpoint,
+                                        const DatagramControl &control ) {
+        m_ReceiveBuffer.OnDrops( control.drops );
+        size_t segment = control.gro_segment_size ? control.gro_segment_size : len;
+        size_t offset  = 0;
+        do {
+            size_t length = std::min( segment, len - offset );
+            if ( offset && !m_SocketFilter.empty()
+                 && !TrapSocketFilterAccepts( data + offset, length, m_SocketFilterCommunityPrefix ) ) {
+                m_Counters.Add( DATAGRAMS_FILTERED );
+            } else {
+                handleDatagram( data + offset, length, remote_endpoint, control );
+            }
+            offset += segment;
+        } while ( offset < len );
+    }
 
-        string parsed_packet = HandleMibPacket(data, len, m_MibDirPath.c_str());
-        if(parsed_packet.empty()){
-            continue;
+    namespace {
+        int64_t realtime_ns() {
+            timespec ts;
+            clock_gettime( CLOCK_REALTIME, &ts );
+            return (int64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
         }
+    } // namespace
 
-        std::string clientIpAddress = remote_endpoint.address().to_string();
-        std::string transport_info = AddTransportInfo(clientIpAddress, remote_endpoint.port(), m_Port);
+    /*
+     * control.received_ns is the kernel's receive time, or 0 if it did not
+     * say.  With stats.latency every stage the trap goes through is timed on
+     * the same clock, so that the queue stage can be measured against it.
+     */
+    void TrapDataUdpDP::handleDatagram( u_char *data, size_t len, const udp::endpoint &remote_endpoint,
+                                        const DatagramControl &control ) {
+        const int64_t received_ns = control.received_ns;
+        SNMP_PROBE1( datagram_received, len );
+        m_Counters.Add( DATAGRAMS_RECEIVED );
+        m_Counters.Add( DATAGRAM_BYTES, len );
 
-        ReportMessage( timestamp, transport_info, parsed_packet);
-    }
+        int64_t stamp = 0;
+        auto    lap   = [&]( Stage stage ) {
+            int64_t now = realtime_ns();
+            m_Latency[stage].Record( now > stamp ? now - stamp : 0 );
+            stamp = now;
+        };
+        if ( m_MeasureLatency ) {
+            stamp = received_ns;
+            if ( received_ns ) {
+                lap( STAGE_QUEUE );
+            } else {
+                stamp = realtime_ns();
+            }
+        }
 
-        //MLOG( DEBUG ) << "Socket loop interrupted...";
-        if ( m_Socket.get() ) {
-           // MLOG( DEBUG ) << "Shutdown socket...";
-            m_Socket->shutdown( boost::asio::socket_base::shutdown_receive, error );
-            m_Socket->close();
-            //MLOG( DEBUG ) << "Shutdown socket done";
+        std::string timestamp = m_TimestampReceived && received_ns ? m_Timestamps.Format( received_ns )
+                                                                   : m_Timestamps.Now();
+
+        int parse_error = SNMPERR_SUCCESS;
+        auto record = DecodeTrap(data, len, m_MibDirPath.c_str(), &parse_error,
+                                 m_TrapFilter.Empty() ? nullptr : &m_TrapFilter,
+                                 m_Communities.Empty() ? nullptr : &m_Communities);
+        if(m_MeasureLatency){
+            lap( STAGE_PARSE );
+        }
+        if(parse_error == SNMPERR_AUTHENTICATION_FAILURE){
+            m_Counters.Add( TRAPS_REJECTED );
+        } else if(parse_error != SNMPERR_SUCCESS){
+            m_Counters.Add( PARSE_FAILURES );
+        } else if(!record){
+            m_Counters.Add( TRAPS_FILTERED );
+        }
+        if(parse_error != SNMPERR_SUCCESS && m_BadPacketOutput.is_open()){
+            sampleBadPacket(timestamp, remote_endpoint.address().to_string(), data, len, parse_error);
+        }
+        if(!record){
+            return;
         }
 
-        return true;
+        if(m_ColumnarSink){
+            m_ColumnarSink->Append(std::chrono::system_clock::now(), remote_endpoint.address().to_string(), *record);
+        }
+
+        string parsed_packet;
+        if(m_OutputFormat != NETSNMP_TRAP_OUTPUT_NONE){
+            parsed_packet = FormatTrap(*record, m_OutputFormat);
+            if(parsed_packet.empty()){
+                return;
+            }
+            m_Counters.Add( TRAPS_FORMATTED );
+            if(m_MeasureLatency){
+                lap( STAGE_FORMAT );
+            }
+        }
+        if(!m_DeliverRecord && m_OutputFormat != NETSNMP_TRAP_OUTPUT_NONE){
+            record.reset();
+        }
+
+        std::string clientIpAddress = remote_endpoint.address().to_string();
+        std::string transport_info;
+        if(control.local_family != AF_UNSPEC){
+            char local_address[INET6_ADDRSTRLEN];
+            inet_ntop(control.local_family, &control.local_address, local_address, sizeof(local_address));
+            transport_info = AddTransportInfo(clientIpAddress, remote_endpoint.port(), local_address, m_Port);
+        } else {
+            transport_info = AddTransportInfo(clientIpAddress, remote_endpoint.port(), m_Port);
+        }
+
+        ReportMessage( timestamp, transport_info, parsed_packet, clientIpAddress, std::move( record ) );
+        if ( m_MeasureLatency ) {
+            lap( STAGE_DELIVER );
+            if ( received_ns ) {
+                m_Latency[STAGE_TOTAL].Record( stamp > received_ns ? stamp - received_ns : 0 );
+            }
+        }
     }
 
     bool TrapDataUdpDP::Stop() {
@@ -102,9 +327,103 @@ bool TrapDataUdpDP::Run() {
         return true;
     }
 
+    TrapDataUdpDP::SocketStats TrapDataUdpDP::GetSocketStats() const {
+        SocketStats stats{ m_Counters.Read( DATAGRAMS_RECEIVED ) - m_ReceivedAtOpen, 0, 0, 0, 0, 0 };
+        uint32_t    drops  = 0;
+        uint32_t    queued = 0;
+        int         fd     = m_SocketFd;
+        if ( fd >= 0 ) {
+            GetSocketDrops( fd, &drops );
+            GetSocketQueued( fd, &queued );
+            stats.receive_buffer = m_ReceiveBuffer.GetSize();
+            stats.buffer_growths = m_ReceiveBuffer.GetGrowths();
+        }
+        stats.queued  = queued;
+        stats.dropped = drops;
+        stats.seen    = stats.passed + drops;
+        return stats;
+    }
+
+    namespace {
+        /*
+         * A rejected community as part of a statistic name: the 32-bit FNV-1a
+         * hash of it in hex, so that a sender's value can be told apart and
+         * checked against a known one without the stats or log showing it.
+         */
+        string community_label( std::string_view community ) {
+            uint32_t hash = 2166136261u;
+            for ( unsigned char c : community ) {
+                hash = ( hash ^ c ) * 16777619u;
+            }
+            char label[9];
+            snprintf( label, sizeof( label ), "%08x", hash );
+            return label;
+        }
+    } // namespace
+
+    IDataProvider::Statistics TrapDataUdpDP::GetStatistics() const {
+        auto        counts = m_Counters.Read();
+        SocketStats socket = GetSocketStats();
+        Statistics  stats{
+                { "datagrams.received", counts[DATAGRAMS_RECEIVED] },
+                { "datagrams.bytes", counts[DATAGRAM_BYTES] },
+                { "datagrams.parse_failures", counts[PARSE_FAILURES] },
+                { "datagrams.truncated", counts[DATAGRAMS_TRUNCATED] },
+                { "datagrams.filtered", counts[DATAGRAMS_FILTERED] },
+                { "traps.formatted", counts[TRAPS_FORMATTED] },
+                { "traps.filtered", counts[TRAPS_FILTERED] },
+                { "traps.rejected", counts[TRAPS_REJECTED] },
+                { "output.bytes", counts[OUTPUT_BYTES] },
+                { "tap.writes", counts[TAP_WRITES] },
+                { "tap.queued", m_TapWriter ? m_TapWriter->GetQueued() : 0 },
+                { "tap.dropped", m_TapWriter ? m_TapWriter->GetDropped() : 0 },
+                { "socket.dropped", socket.dropped },
+                { "socket.receive_buffer", socket.receive_buffer },
+                { "socket.buffer_growths", socket.buffer_growths },
+                { "socket.queued", socket.queued },
+        };
+        if ( m_MeasureLatency ) {
+            static const char *const names[STAGES] = { "queue", "parse", "format", "deliver", "total" };
+            for ( int stage = 0; stage < STAGES; stage++ ) {
+                auto   summary = m_Latency[stage].Summarize();
+                string prefix  = string( "latency." ) + names[stage];
+                stats[prefix + ".count"]   = summary.count;
+                stats[prefix + ".p50_ns"]  = summary.p50;
+                stats[prefix + ".p99_ns"]  = summary.p99;
+                stats[prefix + ".p999_ns"] = summary.p999;
+                stats[prefix + ".max_ns"]  = summary.max;
+            }
+        }
+        if ( !m_Communities.Empty() ) {
+            /* communities are secrets: by position in community.allow, and by hash */
+            m_Communities.ForEach( [&]( size_t position, uint64_t accepted ) {
+                stats["community." + std::to_string( position ) + ".accepted"] = accepted;
+            } );
+            m_Communities.ForEachRejected( [&]( const string &community, uint64_t rejected ) {
+                stats["community.rejected." + community_label( community )] = rejected;
+            } );
+            stats["community.rejected"] = m_Communities.GetRejected();
+        }
+        for ( const auto &rule : m_TrapFilter.GetRuleStats() ) {
+            stats["filter." + rule.rule + ".hits"] = rule.hits;
+        }
+        if ( !m_TrapFilter.Empty() ) {
+            stats["filter.unmatched"] = m_TrapFilter.GetUnmatched();
+        }
+        /* the parser counts over all providers in the process, by what was wrong */
+        for ( int err_class = 0; err_class < ASN_ERR_CLASSES; err_class++ ) {
+            stats[string( "parse_errors." ) + snmp_parse_error_class_name( err_class )] =
+                    snmp_parse_error_count( err_class );
+        }
+        return stats;
+    }
+
     bool TrapDataUdpDP::Configure( LibraryType::Config config, LibraryType::Config config_override ) {
         auto t_config = getConfigWithDefaults( config, config_override );
         bool valid    = true;
+        std::vector<std::pair<string, string>> filter_rules;
+        netsnmp_clear_oid_output_overrides();
+        m_Communities.Clear();
         for ( const auto &kv : t_config ) {
             const string k = kv.first;
             const string v = kv.second;
@@ -131,16 +450,307 @@ bool TrapDataUdpDP::Run() {
                 m_MibDirPath = v;
                 continue;
             }
+            if ( k == "output.format" ) {
+                if ( v == "plain" ) {
+                    m_OutputFormat = NETSNMP_TRAP_OUTPUT_PLAIN;
+                } else if ( v == "json" ) {
+                    m_OutputFormat = NETSNMP_TRAP_OUTPUT_JSON;
+                } else if ( v == "kv" ) {
+                    m_OutputFormat = NETSNMP_TRAP_OUTPUT_KV;
+                } else if ( v == "none" ) {
+                    m_OutputFormat = NETSNMP_TRAP_OUTPUT_NONE;
+                } else {
+                    //MLOG( ERROR ) << "Unknown output format \"" << v << "\"";
+                    valid = false;
+                }
+                continue;
+            }
+            if ( k == "oid.format" || k.rfind( "oid.format.", 0 ) == 0 ) {
+                int format = netsnmp_oid_output_format_by_name( v.c_str() );
+                if ( format < 0 ) {
+                    //MLOG( ERROR ) << "Unknown OID format \"" << v << "\"";
+                    valid = false;
+                } else if ( k == "oid.format" ) {
+                    netsnmp_set_oid_output_format( format );
+                } else if ( !netsnmp_add_oid_output_override( k.c_str() + strlen( "oid.format." ), format ) ) {
+                    //MLOG( ERROR ) << "Invalid trap OID in \"" << k << "\"";
+                    valid = false;
+                }
+                continue;
+            }
+            if ( k == "output.record" ) {
+                m_DeliverRecord = v == "true";
+                continue;
+            }
+            if ( k == "columnar.file" ) {
+                m_ColumnarPath = v;
+                continue;
+            }
+            if ( k == "columnar.batch_rows" || k == "columnar.flush_interval_ms" ) {
+                try {
+                    if ( k == "columnar.batch_rows" ) {
+                        m_ColumnarBatchRows = std::stoul( v );
+                    } else {
+                        m_ColumnarFlushInterval = std::chrono::milliseconds( std::stoul( v ) );
+                    }
+                } catch ( const std::exception &e ) {
+                    //MLOG( ERROR ) << k << " value \"" << v << "\" is invalid : " << e.what();
+                    valid = false;
+                }
+                continue;
+            }
+            if ( k == "debug.bad_packets.file" ) {
+                m_BadPacketOutput.open( v, ios::out | ios::app );
+                if ( !m_BadPacketOutput.is_open() ) {
+                    //MLOG( ERROR ) << "Could not open bad packet file \"" << v << "\"";
+                    valid = false;
+                }
+                continue;
+            }
+            if ( k == "debug.bad_packets.per_second" ) {
+                try {
+                    m_BadPacketsPerSecond = std::stoul( v );
+                } catch ( const std::exception &e ) {
+                    //MLOG( ERROR ) << k << " value \"" << v << "\" is invalid : " << e.what();
+                    valid = false;
+                }
+                continue;
+            }
+            if ( k == "community.allow" ) {
+                /* comma-separated, counted as community.<position>.accepted; empty accepts any community */
+                size_t start = 0;
+                while ( start < v.size() ) {
+                    size_t end = v.find( ',', start );
+                    if ( end == string::npos ) {
+                        end = v.size();
+                    }
+                    if ( end > start ) {
+                        m_Communities.Add( v.substr( start, end - start ) );
+                    }
+                    start = end + 1;
+                }
+                continue;
+            }
+            if ( k == "receive.backend" ) {
+                if ( v != "asio" && ( v != "io_uring" || !UringReceiver::Supported() ) ) {
+                    //MLOG( ERROR ) << "Receive backend \"" << v << "\" is not available";
+                    valid = false;
+                    continue;
+                }
+                m_ReceiveBackend = v;
+                continue;
+            }
+            if ( k == "receive.io_uring.buffers" || k == "receive.io_uring.buffer_size" ) {
+                try {
+                    if ( k == "receive.io_uring.buffers" ) {
+                        m_UringBuffers = std::stoul( v );
+                        if ( m_UringBuffers == 0 || ( m_UringBuffers & ( m_UringBuffers - 1 ) ) ) {
+                            //MLOG( ERROR ) << k << " must be a power of two";
+                            valid = false;
+                        }
+                    } else {
+                        m_UringBufferSize = std::stoul( v );
+                    }
+                } catch ( const std::exception &e ) {
+                    //MLOG( ERROR ) << k << " value \"" << v << "\" is invalid : " << e.what();
+                    valid = false;
+                }
+                continue;
+            }
+            if ( k == "receive.buffer_size" || k == "receive.buffer_size.max" ) {
+                try {
+                    if ( k == "receive.buffer_size" ) {
+                        m_ReceiveBufferSize = std::stoul( v );
+                    } else {
+                        m_ReceiveBufferMaxSize = std::stoul( v );
+                    }
+                } catch ( const std::exception &e ) {
+                    //MLOG( ERROR ) << k << " value \"" << v << "\" is invalid : " << e.what();
+                    valid = false;
+                }
+                continue;
+            }
+            if ( k == "receive.gro" ) {
+                m_UseGro = v == "true";
+                continue;
+            }
+            if ( k == "receive.bpf" ) {
+                m_UseSocketFilter = v == "true";
+                continue;
+            }
+            if ( k == "receive.bpf.community_prefix" ) {
+                m_SocketFilterCommunityPrefix = v;
+                continue;
+            }
+            if ( k.rfind( "filter.", 0 ) == 0 ) {
+                if ( v != "allow" && v != "deny" ) {
+                    //MLOG( ERROR ) << k << " must be \"allow\" or \"deny\"";
+                    valid = false;
+                    continue;
+                }
+                filter_rules.emplace_back( k.substr( strlen( "filter." ) ), v );
+                continue;
+            }
+            if ( k == "mib.display_hint" ) {
+                netsnmp_set_display_hints( v == "true" );
+                continue;
+            }
+            if ( k == "stats.file" ) {
+                m_StatsPath = v;
+                if ( v != "log" ) {
+                    m_StatsOutput.open( v, ios::out | ios::app );
+                    if ( !m_StatsOutput.is_open() ) {
+                        //MLOG( ERROR ) << "Could not open stats file \"" << v << "\"";
+                        valid = false;
+                    }
+                }
+                continue;
+            }
+            if ( k == "stats.interval_ms" ) {
+                try {
+                    m_StatsInterval = std::chrono::milliseconds( std::stoul( v ) );
+                } catch ( const std::exception &e ) {
+                    //MLOG( ERROR ) << k << " value \"" << v << "\" is invalid : " << e.what();
+                    valid = false;
+                }
+                if ( m_StatsInterval.count() == 0 ) {
+                    //MLOG( ERROR ) << k << " must be above 0";
+                    valid = false;
+                }
+                continue;
+            }
+            if ( k == "timestamp.precision" ) {
+                if ( v == "s" ) {
+                    m_Timestamps.SetPrecision( TimestampFormatter::SECONDS );
+                } else if ( v == "ms" ) {
+                    m_Timestamps.SetPrecision( TimestampFormatter::MILLISECONDS );
+                } else if ( v == "us" ) {
+                    m_Timestamps.SetPrecision( TimestampFormatter::MICROSECONDS );
+                } else {
+                    //MLOG( ERROR ) << k << " must be \"s\", \"ms\" or \"us\"";
+                    valid = false;
+                }
+                continue;
+            }
+            if ( k == "timestamp.source" ) {
+                if ( v != "processing" && v != "receive" ) {
+                    //MLOG( ERROR ) << k << " must be \"processing\" or \"receive\"";
+                    valid = false;
+                    continue;
+                }
+                m_TimestampReceived = v == "receive";
+                continue;
+            }
+            if ( k == "stats.latency" ) {
+                m_MeasureLatency = v == "true";
+                continue;
+            }
             if ( k == "tap.file" ) {
-                m_DoTap = true;
-                m_TapOutput.open( v, ios::out | ios::app );
-            if ( !m_TapOutput.is_open() ) {
-
-                //MLOG( ERROR ) << "Could not open tap-file \"" << v << "\"";
-                valid = false;
+                m_DoTap   = true;
+                m_TapPath = v;
+                continue;
+            }
+            if ( k == "tap.compress" ) {
+                if ( v == "none" ) {
+                    m_TapPolicy.compression = TapWriter::NONE;
+                } else if ( v == "gzip" ) {
+                    m_TapPolicy.compression = TapWriter::GZIP;
+                } else if ( v == "zstd" ) {
+                    m_TapPolicy.compression = TapWriter::ZSTD;
+                } else {
+                    //MLOG( ERROR ) << k << " must be \"none\", \"gzip\" or \"zstd\"";
+                    valid = false;
+                    continue;
+                }
+                if ( !TapWriter::Supported( m_TapPolicy.compression ) ) {
+                    //MLOG( ERROR ) << "Tap compression \"" << v << "\" is not available";
+                    valid = false;
+                }
+                continue;
+            }
+            if ( k == "tap.compress.level" || k == "tap.compress.frame_bytes" ) {
+                try {
+                    if ( k == "tap.compress.level" ) {
+                        m_TapPolicy.compression_level = std::stoi( v );
+                    } else {
+                        m_TapPolicy.frame_bytes = std::stoul( v );
+                    }
+                } catch ( const std::exception &e ) {
+                    //MLOG( ERROR ) << k << " value \"" << v << "\" is invalid : " << e.what();
+                    valid = false;
+                }
+                continue;
+            }
+            if ( k == "tap.echo" ) {
+                m_TapPolicy.echo = v == "true";
+                continue;
             }
+            if ( k == "tap.flush_bytes" || k == "tap.flush_interval_ms" || k == "tap.rotate_bytes"
+                 || k == "tap.rotate_interval_s" || k == "tap.max_queued_bytes" ) {
+                try {
+                    if ( k == "tap.flush_bytes" ) {
+                        m_TapPolicy.flush_bytes = std::stoul( v );
+                    } else if ( k == "tap.flush_interval_ms" ) {
+                        m_TapPolicy.flush_interval = std::chrono::milliseconds( std::stoul( v ) );
+                    } else if ( k == "tap.rotate_bytes" ) {
+                        m_TapPolicy.rotate_bytes = std::stoull( v );
+                    } else if ( k == "tap.max_queued_bytes" ) {
+                        m_TapPolicy.max_queued_bytes = std::stoul( v );
+                    } else {
+                        m_TapPolicy.rotate_interval = std::chrono::seconds( std::stoul( v ) );
+                    }
+                } catch ( const std::exception &e ) {
+                    //MLOG( ERROR ) << k << " value \"" << v << "\" is invalid : " << e.what();
+                    valid = false;
+                }
+                continue;
+        }
+    }
+    /* trap OID rules may name MIB objects, so they are resolved once the MIBs are loaded */
+    m_TrapFilter.Clear();
+    if ( !filter_rules.empty() && !m_MibDirPath.empty() ) {
+        init_mib( m_MibDirPath.c_str() );
+    }
+    for ( const auto &[name, action] : filter_rules ) {
+        oid    prefix[MAX_OID_LEN];
+        size_t prefix_len = MAX_OID_LEN;
+        if ( !netsnmp_resolve_oid( name.c_str(), prefix, &prefix_len ) ) {
+            //MLOG( ERROR ) << "Cannot resolve trap filter OID \"" << name << "\"";
+            valid = false;
             continue;
         }
+        m_TrapFilter.AddRule( std::span<const oid>( prefix, prefix_len ),
+                              action == "allow" ? TrapOidFilter::ALLOW : TrapOidFilter::DENY, name );
+    }
+    if ( m_UseGro && m_ReceiveBackend == "io_uring"
+         && m_UringBufferSize < UringReceiver::Overhead( DatagramControl::SPACE ) + 65535 ) {
+        // a coalesced burst cut short would lose whole datagrams
+        //MLOG( ERROR ) << "receive.gro needs receive.io_uring.buffer_size to hold 64 KB";
+        valid = false;
+    }
+    m_SocketFilter.clear();
+    if ( m_UseSocketFilter ) {
+        m_SocketFilter = BuildTrapSocketFilter( m_SocketFilterCommunityPrefix );
+        if ( m_SocketFilter.empty() ) {
+            //MLOG( ERROR ) << "receive.bpf.community_prefix is too long";
+            valid = false;
+        }
+    }
+    if ( m_DoTap ) {
+        m_TapWriter = std::make_unique<TapWriter>( m_TapPath, m_TapPolicy );
+        if ( !m_TapWriter->Open() ) {
+            //MLOG( ERROR ) << "Could not open tap-file \"" << m_TapPath << "\"";
+            m_TapWriter.reset();
+            valid = false;
+        }
+    }
+    if ( !m_ColumnarPath.empty() ) {
+        m_ColumnarSink = std::make_unique<ColumnarTrapSink>( m_ColumnarPath, m_ColumnarBatchRows, m_ColumnarFlushInterval );
+        if ( !m_ColumnarSink->Open() ) {
+            //MLOG( ERROR ) << "Could not open columnar file \"" << m_ColumnarPath << "\"";
+            m_ColumnarSink.reset();
+            valid = false;
+        }
     }
     if ( !m_Port ) {
         //MLOG( ERROR ) << "Listen Port is required";
@@ -155,7 +765,8 @@ bool TrapDataUdpDP::Run() {
 }
 LibraryType::Config TrapDataUdpDP::getConfigWithDefaults( LibraryType::Config config, LibraryType::Config config_override ) {
     LibraryType::Config config_defaults{
-            { "port", "515" }, { "address", "0.0.0.0" }, { "exit_on_socket_error", "true" },
+            { "port", "515" }, { "address", "0.0.0.0" }, { "exit_on_socket_error", "true" }, { "output.format", "plain" },
+            { "oid.format", "module" }, { "receive.backend", "asio" },
             //
     };
     //MLOG( DEBUG ) << "config override " << config_override;
@@ -176,7 +787,91 @@ LibraryType::Config TrapDataUdpDP::getConfigWithDefaults( LibraryType::Config co
     counters_->events_received++;
 }*/
 
+/*
+ * With stats.file, a thread writes the statistics every stats.interval_ms
+ * while Run receives, and once more when it stops.
+ */
+void TrapDataUdpDP::startStatsDump() {
+    if ( m_StatsPath.empty() || m_StatsThread.joinable() ) {
+        return;
+    }
+    m_StatsStop   = false;
+    m_StatsThread = std::thread( [this] {
+        std::unique_lock<std::mutex> lock( m_StatsMutex );
+        while ( !m_StatsWake.wait_for( lock, m_StatsInterval, [this] { return m_StatsStop; } ) ) {
+            writeStatistics();
+        }
+    } );
+}
+
+void TrapDataUdpDP::stopStatsDump() {
+    if ( !m_StatsThread.joinable() ) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock( m_StatsMutex );
+        m_StatsStop = true;
+    }
+    m_StatsWake.notify_one();
+    m_StatsThread.join();
+    writeStatistics();
+}
+
+/* One line per dump: the timestamp, then name=value for every counter. */
+void TrapDataUdpDP::writeStatistics() {
+    string line = AddTimestamp();
+    for ( const auto &[name, value] : GetStatistics() ) {
+        line += name;
+        line += '=';
+        line += std::to_string( value );
+        line += ' ';
+    }
+    line.back() = '\n';
+    if ( m_StatsPath == "log" ) {
+        //MLOG( INFO ) << line;
+        std::clog << line << std::flush;
+    } else {
+        m_StatsOutput << line << std::flush;
+    }
+}
+
+/*
+ * Writes at most debug.bad_packets.per_second undecodable packets a second
+ * as hex, the rest are only counted by the parser.
+ */
+void TrapDataUdpDP::sampleBadPacket( const string &timestamp, const string &ip_addr, const u_char *data, size_t len,
+                                     int error ) {
+    time_t now = time( nullptr );
+    if ( now != m_BadPacketSecond ) {
+        m_BadPacketSecond      = now;
+        m_BadPacketsThisSecond = 0;
+    }
+    if ( m_BadPacketsThisSecond >= m_BadPacketsPerSecond ) {
+        return;
+    }
+    m_BadPacketsThisSecond++;
+
+    static const char hex[] = "0123456789abcdef";
+    string            dump( len * 2, ' ' );
+    for ( size_t i = 0; i < len; i++ ) {
+        dump[2 * i]     = hex[data[i] >> 4];
+        dump[2 * i + 1] = hex[data[i] & 0x0F];
+    }
+    m_BadPacketOutput << timestamp << ip_addr << " error=" << error << " len=" << len << ' ' << dump << '\n';
+}
+
+/* Queued for the tap writer, which also echoes it to stdout with tap.echo. */
 void TrapDataUdpDP::tapMessage( const string &timestamp, const string &ip_addr, const string &msg ) {
-    std::cout << timestamp << ' ' << ip_addr << ' ' << msg << endl;
-    m_TapOutput << timestamp << ' ' << ip_addr << ' ' << msg << endl; }
+    string record;
+    record.reserve( timestamp.size() + ip_addr.size() + msg.size() + 3 );
+    record += timestamp;
+    record += ' ';
+    record += ip_addr;
+    record += ' ';
+    record += msg;
+    record += '\n';
+    m_Counters.Add( TAP_WRITES );
+    SNMP_PROBE3( sink_write, "tap", 1, record.size() );
+    m_TapWriter->Write( std::move( record ) );
+}
 
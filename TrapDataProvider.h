@@ -2,14 +2,27 @@
 
 #include "IDataProvider.h"
 #include "packet_handler.h"
+#include "columnar_sink.h"
+#include "socket_filter.h"
+#include "uring_receiver.h"
+#include "datagram_control.h"
+#include "receive_buffer.h"
+#include "thread_counters.h"
+#include "latency_histogram.h"
+#include "timestamp_format.h"
+#include "tap_writer.h"
 
 #include <boost/array.hpp>
 #include <boost/asio.hpp>
+#include <atomic>
+#include <condition_variable>
 #include <ctime>
 #include <iostream>
 #include <memory>
 #include <string>
 #include <fstream>
+#include <mutex>
+#include <thread>
 
 using boost::asio::ip::udp;
 
@@ -26,10 +39,65 @@ public:
 
     bool Configure( LibraryType::Config config, LibraryType::Config config_override ) override;
 
+    struct SocketStats {
+        uint64_t passed;         // datagrams read from the socket
+        uint64_t seen;           // passed plus dropped
+        uint64_t dropped;        // by the kernel, through receive.bpf or for want of buffer space
+        uint64_t receive_buffer; // bytes, as SO_RCVBUF reports it
+        uint64_t buffer_growths; // times receive.buffer_size.max let it grow
+        uint64_t queued;         // bytes waiting in the receive queue
+    };
+    /** Counts since the socket was opened, all zero before Run. */
+    SocketStats GetSocketStats() const;
+
+    /** Counts since the provider was created, plus the socket's and the parser's. */
+    Statistics GetStatistics() const override;
+
 private:
-    void                       ReportMessage( string &Timestamp, string &IpAddress, string &Message );
+    /*
+     * A datagram counts as a parse failure, a rejected or a filtered trap,
+     * or a formatted one; a varbind list that breaks off counts as a parse
+     * failure and is still formatted with the varbinds before the error.
+     */
+    enum Counter {
+        DATAGRAMS_RECEIVED,
+        DATAGRAM_BYTES,
+        DATAGRAMS_TRUNCATED,
+        DATAGRAMS_FILTERED, // coalesced behind one the socket filter passed, and failing it
+        PARSE_FAILURES,
+        TRAPS_FORMATTED,
+        TRAPS_FILTERED,
+        TRAPS_REJECTED,
+        OUTPUT_BYTES,
+        TAP_WRITES,
+        COUNTERS
+    };
+
+    /* Where a trap spends its time, each stage timed from the end of the last. */
+    enum Stage {
+        STAGE_QUEUE,   // kernel receive to read by Run
+        STAGE_PARSE,   // DecodeTrap, MIB lookups included
+        STAGE_FORMAT,  // FormatTrap
+        STAGE_DELIVER, // tap and listener
+        STAGE_TOTAL,   // kernel receive to delivered
+        STAGES
+    };
+
+    void                       ReportMessage( string &Timestamp, string &IpAddress, string &Message, string &ClientIpAddress,
+                                              std::shared_ptr<const TrapRecord> record );
+    void                       receiveAsio();
+    bool                       receiveUring();
+    void                       handleReceived( u_char *data, size_t len, const udp::endpoint &remote_endpoint,
+                                               const DatagramControl &control );
+    void                       handleDatagram( u_char *data, size_t len, const udp::endpoint &remote_endpoint,
+                                               const DatagramControl &control );
     static LibraryType::Config getConfigWithDefaults( LibraryType::Config config, LibraryType::Config config_override );
     void                tapMessage(const string& timestamp, const string& ip_addr,  const string &msg );
+    void                sampleBadPacket( const string &timestamp, const string &ip_addr, const u_char *data, size_t len,
+                                         int error );
+    void                startStatsDump();
+    void                stopStatsDump();
+    void                writeStatistics();
 
     int    m_Port{ 0 };
     string m_BindIPAddress;
@@ -40,6 +108,49 @@ private:
 
     boost::asio::io_service io_service;
     bool                    m_DoTap     = false;
-    std::ofstream           m_TapOutput;
+    std::string             m_TapPath;
+    TapWriter::Policy       m_TapPolicy;
+    std::unique_ptr<TapWriter> m_TapWriter;
     std::string             m_MibDirPath;
+    int                     m_OutputFormat = NETSNMP_TRAP_OUTPUT_PLAIN;
+    bool                    m_DeliverRecord = false;
+    TimestampFormatter      m_Timestamps;
+    bool                    m_TimestampReceived = false; // kernel receive time rather than processing time
+    TrapOidFilter           m_TrapFilter;
+    CommunityAllowlist      m_Communities;
+
+    std::string              m_ReceiveBackend;
+    unsigned                 m_UringBuffers         = 256;
+    size_t                   m_UringBufferSize      = 16384;
+    size_t                   m_ReceiveBufferSize    = 0;
+    size_t                   m_ReceiveBufferMaxSize = 0;
+    ReceiveBuffer            m_ReceiveBuffer;
+    bool                     m_UseGro          = false;
+    bool                     m_UseSocketFilter = false;
+    std::string              m_SocketFilterCommunityPrefix;
+    std::vector<sock_filter> m_SocketFilter;
+    std::atomic<int>         m_SocketFd{ -1 };
+    std::atomic<uint64_t>    m_ReceivedAtOpen{ 0 };
+
+    ThreadCounters<COUNTERS>  m_Counters;
+    std::string               m_StatsPath; // or "log"
+    std::ofstream             m_StatsOutput;
+    std::chrono::milliseconds m_StatsInterval{ 60000 };
+    std::thread               m_StatsThread;
+    std::mutex                m_StatsMutex;
+    std::condition_variable   m_StatsWake;
+    bool                      m_StatsStop = false;
+    bool                      m_MeasureLatency = false;
+
+    std::array<LatencyHistogram, STAGES> m_Latency;
+
+    std::unique_ptr<ColumnarTrapSink> m_ColumnarSink;
+    std::string                       m_ColumnarPath;
+    size_t                            m_ColumnarBatchRows       = 4096;
+    std::chrono::milliseconds         m_ColumnarFlushInterval{ 1000 };
+
+    std::ofstream m_BadPacketOutput;
+    unsigned      m_BadPacketsPerSecond = 1;
+    time_t        m_BadPacketSecond     = 0;
+    unsigned      m_BadPacketsThisSecond = 0;
 };
@@ -0,0 +1,351 @@
+/*
+ * Microbenchmark of BER decoding: every field of a set of SNMPv2c traps
+ * decoded with the asn_parse_* functions, as parse_pdu did before
+ * BerReader, and with BerReader and VarBindReader, as it does now; then
+ * parse_pdu itself, variable allocation included.
+ *
+ *   ber_reader_bench [rounds [file]]
+ *
+ * file has one hex-encoded message per line; without it a built-in set
+ * of traps is decoded.  Messages that do not decode are left out.
+ */
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "varbind_reader.h"
+
+/* not declared in packet_parser.h */
+u_char *asn_parse_unsigned_int( u_char *data, size_t *datalength, u_char *type, u_long *intp, size_t intsize );
+
+namespace {
+    typedef std::vector<uint8_t> Bytes;
+
+    Bytes tlv( uint8_t type, const Bytes &contents ) {
+        Bytes out{ type };
+        if ( contents.size() < 128 ) {
+            out.push_back( contents.size() );
+        } else {
+            out.push_back( 0x82 );
+            out.push_back( contents.size() >> 8 );
+            out.push_back( contents.size() );
+        }
+        out.insert( out.end(), contents.begin(), contents.end() );
+        return out;
+    }
+
+    /* the fewest contents bytes that keep the sign, or that read as unsigned */
+    Bytes number( uint8_t type, int64_t value, bool is_unsigned = false ) {
+        Bytes contents;
+        for ( ;; ) {
+            contents.insert( contents.begin(), uint8_t( value ) );
+            value >>= 8;
+            bool negative = contents[0] & 0x80;
+            if ( is_unsigned ? value == 0 && !negative : value == ( negative ? -1 : 0 ) ) {
+                return tlv( type, contents );
+            }
+        }
+    }
+
+    Bytes objid( const char *dotted ) {
+        std::vector<unsigned long> subids;
+        for ( const char *p = dotted; *p; ) {
+            subids.push_back( strtoul( p, (char **) &p, 10 ) );
+            p += *p == '.';
+        }
+        subids[1] += subids[0] * 40;
+        Bytes contents;
+        for ( size_t i = 1; i < subids.size(); i++ ) {
+            uint8_t encoded[10];
+            int     n    = 0;
+            encoded[n++] = subids[i] & 0x7f;
+            while ( subids[i] >>= 7 ) {
+                encoded[n++] = 0x80 | ( subids[i] & 0x7f );
+            }
+            while ( n ) {
+                contents.push_back( encoded[--n] );
+            }
+        }
+        return tlv( ASN_OBJECT_ID, contents );
+    }
+
+    Bytes string( const std::string &text, uint8_t type = ASN_OCTET_STR ) {
+        return tlv( type, Bytes( text.begin(), text.end() ) );
+    }
+
+    Bytes trap( const std::vector<std::pair<const char *, Bytes>> &varbinds ) {
+        Bytes list;
+        for ( const auto &[name, value] : varbinds ) {
+            Bytes vb = objid( name );
+            vb.insert( vb.end(), value.begin(), value.end() );
+            vb = tlv( ASN_SEQUENCE | ASN_CONSTRUCTOR, vb );
+            list.insert( list.end(), vb.begin(), vb.end() );
+        }
+        Bytes pdu = number( ASN_INTEGER, 1234 );
+        for ( const Bytes &field : { number( ASN_INTEGER, 0 ), number( ASN_INTEGER, 0 ),
+                                     tlv( ASN_SEQUENCE | ASN_CONSTRUCTOR, list ) } ) {
+            pdu.insert( pdu.end(), field.begin(), field.end() );
+        }
+        Bytes message = number( ASN_INTEGER, SNMP_VERSION_2c );
+        for ( const Bytes &field : { string( "public" ), tlv( SNMP_MSG_TRAP2, pdu ) } ) {
+            message.insert( message.end(), field.begin(), field.end() );
+        }
+        return tlv( ASN_SEQUENCE | ASN_CONSTRUCTOR, message );
+    }
+
+    std::vector<Bytes> builtin_traps() {
+        const char *uptime   = "1.3.6.1.2.1.1.3.0";
+        const char *trap_oid = "1.3.6.1.6.3.1.1.4.1.0";
+        return {
+                trap( { { uptime, number( ASN_TIMETICKS, 123456, true ) },
+                        { trap_oid, objid( "1.3.6.1.6.3.1.1.5.3" ) },
+                        { "1.3.6.1.2.1.2.2.1.1.7", number( ASN_INTEGER, 7 ) },
+                        { "1.3.6.1.2.1.2.2.1.7.7", number( ASN_INTEGER, 2 ) },
+                        { "1.3.6.1.2.1.2.2.1.8.7", number( ASN_INTEGER, 2 ) } } ),
+                trap( { { uptime, number( ASN_TIMETICKS, 123456, true ) },
+                        { trap_oid, objid( "1.3.6.1.6.3.1.1.5.4" ) },
+                        { "1.3.6.1.2.1.31.1.1.1.18.3", string( "uplink to core, rack 12" ) },
+                        { "1.3.6.1.2.1.31.1.1.1.1.3", string( "Gi0/3" ) },
+                        { "1.3.6.1.2.1.2.2.1.6.3", string( std::string( "\x00\x1b\x2c\x0a\xff\x09", 6 ) ) } } ),
+                trap( { { uptime, number( ASN_TIMETICKS, 123456, true ) },
+                        { trap_oid, objid( "1.3.6.1.4.1.9.9.41.2.0.1" ) },
+                        { "1.3.6.1.4.1.9.9.41.1.2.3.1.5.77", string( std::string( 64, 'x' ) ) },
+                        { "1.3.6.1.2.1.31.1.1.1.6.5", number( ASN_COUNTER64, INT64_MAX, true ) },
+                        { "1.3.6.1.2.1.2.2.1.10.5", number( ASN_COUNTER, 4000000000, true ) },
+                        { "1.3.6.1.2.1.2.2.1.5.5", number( ASN_GAUGE, 1000000000, true ) },
+                        { "1.3.6.1.2.1.1.2.0", objid( "1.3.6.1.4.1.9.1.1208" ) } } ),
+                trap( { { uptime, number( ASN_TIMETICKS, 123456, true ) },
+                        { trap_oid, objid( "1.3.6.1.6.3.1.1.5.3" ) },
+                        { "1.3.6.1.2.1.31.1.9.1.4.1.4.10.0.0.1.3.97.98.99", number( ASN_INTEGER, 6 ) },
+                        { "1.3.6.1.2.1.4.20.1.1.192.168.1.10", string( "\xc0\xa8\x01\x0a", ASN_IPADDRESS ) },
+                        { "1.3.6.1.2.1.1.1.0", string( "" ) } } ),
+        };
+    }
+
+    std::vector<Bytes> read_hex( const char *path ) {
+        std::vector<Bytes> messages;
+        std::ifstream      in( path );
+        std::string        line;
+        while ( std::getline( in, line ) ) {
+            Bytes message;
+            for ( size_t i = 0; i + 1 < line.size(); i += 2 ) {
+                message.push_back( std::stoi( line.substr( i, 2 ), nullptr, 16 ) );
+            }
+            messages.push_back( message );
+        }
+        return messages;
+    }
+
+    /* Each decoder returns the varbinds decoded, or -1, and adds what it read to sink. */
+    long decode_asn_parse( Bytes &message, uint64_t &sink ) {
+        u_char *data = message.data();
+        size_t  left = message.size();
+        u_char  community[COMMUNITY_MAX_LEN];
+        size_t  community_len = sizeof( community );
+        long    version, reqid, errstat, errindex;
+        u_char  type;
+
+        data = snmp_comstr_parse( data, &left, community, &community_len, &version );
+        if ( data && ( data = asn_parse_header( data, &left, &type ) )
+             && ( data = asn_parse_int( data, &left, &type, &reqid, sizeof( reqid ) ) )
+             && ( data = asn_parse_int( data, &left, &type, &errstat, sizeof( errstat ) ) )
+             && ( data = asn_parse_int( data, &left, &type, &errindex, sizeof( errindex ) ) ) ) {
+            data = asn_parse_sequence( data, &left, &type, ASN_SEQUENCE | ASN_CONSTRUCTOR, "varbinds" );
+        }
+        if ( !data ) {
+            return -1;
+        }
+        sink += version + reqid + community_len;
+
+        long count = 0;
+        while ( left > 0 ) {
+            oid     name[MAX_OID_LEN], value_oid[MAX_OID_LEN];
+            size_t  name_len = MAX_OID_LEN, value_len, value_left;
+            u_char *value, buffer[4096];
+            u_long  unsigned_value = 0;
+            long    integer = 0;
+            struct counter64 counter{};
+
+            data = snmp_parse_var_op( data, name, &name_len, &type, &value_len, &value, &left );
+            if ( !data ) {
+                return -1;
+            }
+            value_left = data - value;
+            switch ( type ) {
+                case ASN_INTEGER:
+                    value = asn_parse_int( value, &value_left, &type, &integer, sizeof( integer ) );
+                    sink += integer;
+                    break;
+                case ASN_COUNTER:
+                case ASN_GAUGE:
+                case ASN_TIMETICKS:
+                    value = asn_parse_unsigned_int( value, &value_left, &type, &unsigned_value,
+                                                    sizeof( unsigned_value ) );
+                    sink += unsigned_value;
+                    break;
+                case ASN_COUNTER64:
+                    value = asn_parse_unsigned_int64( value, &value_left, &type, &counter, sizeof( counter ) );
+                    sink += counter.low;
+                    break;
+                case ASN_OCTET_STR:
+                case ASN_IPADDRESS:
+                    value_len = sizeof( buffer );
+                    value     = asn_parse_string( value, &value_left, &type, buffer, &value_len );
+                    sink += value_len;
+                    break;
+                case ASN_OBJECT_ID:
+                    value_len = MAX_OID_LEN;
+                    value     = asn_parse_objid( value, &value_left, &type, value_oid, &value_len );
+                    sink += value_len;
+                    break;
+                default:
+                    break;
+            }
+            if ( !value ) {
+                return -1;
+            }
+            sink += name_len + name[name_len - 1];
+            count++;
+        }
+        return count;
+    }
+
+    long decode_ber_reader( Bytes &message, uint64_t &sink ) {
+        BerReader                reader( message );
+        std::span<const uint8_t> community;
+        long                     version, reqid, errstat, errindex;
+        uint8_t                  type;
+
+        if ( !reader.EnterSequence( ASN_SEQUENCE | ASN_CONSTRUCTOR ) || !reader.ReadInteger( type, version )
+             || !reader.ReadString( type, community ) || !reader.Enter( type ) || !reader.ReadInteger( type, reqid )
+             || !reader.ReadInteger( type, errstat ) || !reader.ReadInteger( type, errindex )
+             || !reader.EnterSequence( ASN_SEQUENCE | ASN_CONSTRUCTOR ) ) {
+            return -1;
+        }
+        sink += version + reqid + community.size();
+
+        VarBindReader list( reader.Data() );
+        VarBindView   vb;
+        long          count = 0;
+        while ( list.Next( vb ) ) {
+            oid                      name[MAX_OID_LEN], value_oid[MAX_OID_LEN];
+            size_t                   name_len = MAX_OID_LEN, value_len = MAX_OID_LEN;
+            std::span<const uint8_t> text;
+            u_long                   unsigned_value = 0;
+            long                     integer = 0;
+            struct counter64         counter{};
+            BerReader                value( vb.value );
+            bool                     ok = true;
+
+            if ( !BerReader( vb.name ).ReadObjid( type, name, name_len ) ) {
+                return -1;
+            }
+            switch ( vb.type ) {
+                case ASN_INTEGER:
+                    ok = value.ReadInteger( type, integer );
+                    sink += integer;
+                    break;
+                case ASN_COUNTER:
+                case ASN_GAUGE:
+                case ASN_TIMETICKS:
+                    ok = value.ReadUnsigned( type, unsigned_value );
+                    sink += unsigned_value;
+                    break;
+                case ASN_COUNTER64:
+                    ok = value.ReadCounter64( type, counter );
+                    sink += counter.low;
+                    break;
+                case ASN_OCTET_STR:
+                case ASN_IPADDRESS:
+                    ok = value.ReadString( type, text );
+                    sink += text.size();
+                    break;
+                case ASN_OBJECT_ID:
+                    ok = value.ReadObjid( type, value_oid, value_len );
+                    sink += value_len;
+                    break;
+                default:
+                    break;
+            }
+            if ( !ok ) {
+                return -1;
+            }
+            sink += name_len + name[name_len - 1];
+            count++;
+        }
+        return list.Error() >= 0 ? -1 : count;
+    }
+
+    long decode_parse_pdu( Bytes &message, uint64_t &sink ) {
+        snmp_pdu pdu{};
+        size_t   length = message.size();
+        long     count  = 0;
+        if ( parse_pdu( message.data(), &length, &pdu ) == SNMPERR_SUCCESS ) {
+            for ( auto *vp = pdu.variables; vp; vp = vp->next_variable ) {
+                sink += vp->name_length;
+                count++;
+            }
+        } else {
+            count = -1;
+        }
+        snmp_free_varbind( pdu.variables );
+        return count;
+    }
+
+    /* Best of seven runs, in nanoseconds per message. */
+    template <typename Decode>
+    double time_decoder( std::vector<Bytes> &messages, int rounds, Decode decode, uint64_t &sink ) {
+        double best = 1e300;
+        for ( int run = 0; run < 7; run++ ) {
+            auto start = std::chrono::steady_clock::now();
+            for ( int round = 0; round < rounds; round++ ) {
+                for ( Bytes &message : messages ) {
+                    decode( message, sink );
+                }
+            }
+            std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+            best = std::min( best, elapsed.count() / ( (double) rounds * messages.size() ) );
+        }
+        return best;
+    }
+} // namespace
+
+int main( int argc, char **argv ) {
+    int                rounds   = argc > 1 ? atoi( argv[1] ) : 20000;
+    std::vector<Bytes> messages = argc > 2 ? read_hex( argv[2] ) : builtin_traps();
+
+    /* keep what all three decode, and check that they agree on it */
+    std::vector<Bytes> usable;
+    size_t             bytes = 0, varbinds = 0;
+    for ( Bytes &message : messages ) {
+        uint64_t a = 0, b = 0, c = 0;
+        long     count = decode_asn_parse( message, a );
+        if ( count < 0 || decode_ber_reader( message, b ) != count || decode_parse_pdu( message, c ) != count ) {
+            continue;
+        }
+        if ( a != b ) {
+            printf( "asn_parse_* and BerReader disagree on message %zu\n", usable.size() );
+            return 1;
+        }
+        usable.push_back( message );
+        bytes += message.size();
+        varbinds += count;
+    }
+    if ( usable.empty() ) {
+        printf( "no message to decode\n" );
+        return 1;
+    }
+
+    uint64_t sink = 0;
+    double   asn_parse  = time_decoder( usable, rounds, decode_asn_parse, sink );
+    double   ber_reader = time_decoder( usable, rounds, decode_ber_reader, sink );
+    double   pdu        = time_decoder( usable, rounds, decode_parse_pdu, sink );
+    printf( "%zu messages, %zu bytes, %zu varbinds\n", usable.size(), bytes, varbinds );
+    printf( "asn_parse_*   %8.1f ns/message\n", asn_parse );
+    printf( "BerReader     %8.1f ns/message  (%.2fx)\n", ber_reader, asn_parse / ber_reader );
+    printf( "parse_pdu     %8.1f ns/message, allocation included\n", pdu );
+    return sink == 42;
+}
@@ -0,0 +1,114 @@
+/*
+ * Throughput of the tap file, plain and through each codec the library
+ * was built with: the same records written through a TapWriter, timed
+ * from the first Write() until the writer thread has drained the queue
+ * and closed the file, with the size of the file that came out.
+ *
+ *   tap_writer_bench [rounds [file]]
+ *
+ * file is a tap file to replay, a record being a line that starts with a
+ * timestamp and the lines up to the next, replayed rounds times; a zstd
+ * window spans many rounds of a small file, so that flatters zstd.
+ * Without it, rounds times 1000 distinct linkDown/linkUp records are
+ * written.  The output goes to $TMPDIR (or /tmp) and is removed
+ * afterwards.
+ */
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+#include "tap_writer.h"
+
+namespace {
+    /* linkDown/linkUp traps as the tap file has them, varied as a busy agent's would be */
+    std::vector<std::string> built_in_records( int count ) {
+        std::vector<std::string> records;
+        char                     record[1024];
+        for ( int i = 0; i < count; i++ ) {
+            int index = 1 + i * 7 % 48;
+            snprintf( record, sizeof( record ),
+                      "2026-10-19 05:53:%.2d  UDP: [10.1.%d.%d]:%d->[10.0.0.1]:162 SNMPv2-MIB::sysUpTime.0 = "
+                      "Timeticks: (%d) %d:%.2d:%.2d.%.2d, SNMPv2-MIB::snmpTrapOID.0 = OID: IF-MIB::%s, "
+                      "IF-MIB::ifIndex.%d = INTEGER: %d, IF-MIB::ifAdminStatus.%d = INTEGER: up(1), "
+                      "IF-MIB::ifOperStatus.%d = INTEGER: %s, IF-MIB::ifName.%d = STRING: \"Gi0/%d\", "
+                      "IF-MIB::ifAlias.%d = STRING: \"uplink to rack %d\"\n",
+                      i % 60, i / 1000 % 256, 1 + i % 200, 30000 + i * 37 % 20000, 123456 + i * 311, i / 360,
+                      i / 6 % 60, i % 60, i % 100, i % 2 ? "linkUp" : "linkDown", index, index, index, index,
+                      i % 2 ? "up(1)" : "down(2)", index, index, index, index % 24 );
+            records.push_back( record );
+        }
+        return records;
+    }
+
+    std::vector<std::string> read_records( const char *path ) {
+        std::vector<std::string> records;
+        std::ifstream            in( path );
+        std::string              line;
+        while ( std::getline( in, line ) ) {
+            bool stamped = line.size() > 4 && line[4] == '-';
+            if ( stamped || records.empty() ) {
+                records.emplace_back();
+            }
+            records.back() += line;
+            records.back() += '\n';
+        }
+        return records;
+    }
+} // namespace
+
+int main( int argc, char **argv ) {
+    int                      rounds  = argc > 1 ? atoi( argv[1] ) : 100;
+    int                      replays = argc > 2 ? rounds : 1;
+    std::vector<std::string> records = argc > 2 ? read_records( argv[2] ) : built_in_records( 1000 * rounds );
+    if ( records.empty() ) {
+        printf( "no records\n" );
+        return 1;
+    }
+    const char *dir = getenv( "TMPDIR" ) ? getenv( "TMPDIR" ) : "/tmp";
+
+    static const struct {
+        TapWriter::Compression compression;
+        const char            *name;
+    } codecs[] = { { TapWriter::NONE, "plain" }, { TapWriter::GZIP, "gzip" }, { TapWriter::ZSTD, "zstd" } };
+    printf( "%zu records, written %d times\n", records.size(), replays );
+    for ( const auto &codec : codecs ) {
+        if ( !TapWriter::Supported( codec.compression ) ) {
+            printf( "%-5s not built in\n", codec.name );
+            continue;
+        }
+        std::string path = std::string( dir ) + "/tap_writer_bench." + codec.name;
+        unlink( path.c_str() );
+
+        TapWriter::Policy policy;
+        policy.compression      = codec.compression;
+        policy.max_queued_bytes = 0; // time the writer, not how much it drops
+        size_t text             = 0;
+        auto   start            = std::chrono::steady_clock::now();
+        {
+            TapWriter writer( path, policy );
+            if ( !writer.Open() ) {
+                printf( "could not open %s\n", path.c_str() );
+                return 1;
+            }
+            for ( int r = 0; r < replays; r++ ) {
+                for ( const std::string &record : records ) {
+                    text += record.size();
+                    writer.Write( record );
+                }
+            }
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        struct stat st;
+        size_t      out = stat( path.c_str(), &st ) == 0 ? st.st_size : 0;
+        printf( "%-5s %8.1f MB/s  %zu bytes in, %zu out, ratio %.1f\n", codec.name, text / elapsed.count() / 1e6,
+                text, out, out ? (double) text / out : 0.0 );
+        unlink( path.c_str() );
+    }
+    return 0;
+}
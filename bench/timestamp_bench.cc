@@ -0,0 +1,71 @@
+/*
+ * Microbenchmark of trap timestamps: AddTimestamp as it was, localtime()
+ * and sprintf() on every call, against the per-second cache of
+ * TimestampFormatter at each precision.  Before timing, the formatter is
+ * checked against strftime() on random times.
+ *
+ *   timestamp_bench [calls]
+ *
+ * localtime() cost depends on the zone, so try it with TZ set as well.
+ */
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+
+#include "timestamp_format.h"
+
+namespace {
+    /* AddTimestamp() before TimestampFormatter */
+    std::string old_add_timestamp() {
+        time_t     now;
+        struct tm *now_parsed;
+        time( &now );
+        now_parsed = localtime( &now );
+        char safe_bfr[200];
+        sprintf( safe_bfr, "%.4d-%.2d-%.2d %.2d:%.2d:%.2d ", now_parsed->tm_year + 1900, now_parsed->tm_mon + 1,
+                 now_parsed->tm_mday, now_parsed->tm_hour, now_parsed->tm_min, now_parsed->tm_sec );
+        return std::string( safe_bfr );
+    }
+
+    template <typename Stamp>
+    double time_calls( long calls, Stamp stamp, size_t &sink ) {
+        auto start = std::chrono::steady_clock::now();
+        for ( long i = 0; i < calls; i++ ) {
+            sink += stamp().size();
+        }
+        std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+        return elapsed.count() / calls;
+    }
+} // namespace
+
+int main( int argc, char **argv ) {
+    long calls = argc > 1 ? atol( argv[1] ) : 2000000;
+
+    std::mt19937_64    rng( 1 );
+    TimestampFormatter check;
+    for ( int i = 0; i < 100000; i++ ) {
+        int64_t   ns     = (int64_t) ( rng() % 4000000000ULL ) * 500000000 + rng() % 1000000000;
+        time_t    second = ns / 1000000000;
+        char      expected[64];
+        struct tm parsed;
+        localtime_r( &second, &parsed );
+        strftime( expected, sizeof( expected ), "%Y-%m-%d %H:%M:%S ", &parsed );
+        if ( check.Format( ns ) != expected ) {
+            printf( "%lld formats as \"%s\", strftime gives \"%s\"\n", (long long) ns, check.Format( ns ).c_str(),
+                    expected );
+            return 1;
+        }
+    }
+
+    size_t             sink = 0;
+    TimestampFormatter seconds, milliseconds( TimestampFormatter::MILLISECONDS ),
+            microseconds( TimestampFormatter::MICROSECONDS );
+    printf( "TZ=%s, %ld calls\n", getenv( "TZ" ) ? getenv( "TZ" ) : "", calls );
+    printf( "old AddTimestamp      %7.1f ns/call\n", time_calls( calls, old_add_timestamp, sink ) );
+    printf( "TimestampFormatter s  %7.1f ns/call\n", time_calls( calls, [&] { return seconds.Now(); }, sink ) );
+    printf( "TimestampFormatter ms %7.1f ns/call\n", time_calls( calls, [&] { return milliseconds.Now(); }, sink ) );
+    printf( "TimestampFormatter us %7.1f ns/call\n", time_calls( calls, [&] { return microseconds.Now(); }, sink ) );
+    return sink == 42;
+}
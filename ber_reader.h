@@ -0,0 +1,321 @@
+#ifndef SNMP_SHARED_LIB_BER_READER_H
+#define SNMP_SHARED_LIB_BER_READER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <type_traits>
+
+#include "packet_parser.h"
+
+/**
+ * Bounds-checked reader of BER encoded data.
+ *
+ * Every Read* call either consumes one complete element and returns true,
+ * or returns false, leaves the reader where it was and records the
+ * ASN_ERR_* class of the failure in Error().  The readers accept exactly
+ * what the matching asn_parse_* function accepts, but know where the
+ * buffer ends and need no output-size arguments.  Spans handed out point
+ * into the buffer, which must outlive them.
+ */
+class BerReader {
+public:
+    explicit BerReader( std::span<const uint8_t> data )
+            : m_Pos( data.data() ), m_End( data.data() + data.size() ) {}
+
+    bool   Empty() const { return m_Pos >= m_End; }
+    size_t Remaining() const { return m_End - m_Pos; }
+    int    Error() const { return m_Error; }
+
+    /** What is left to read. */
+    std::span<const uint8_t> Data() const { return { m_Pos, m_End }; }
+
+    /**
+     * Steps into a constructed element: consumes its header and limits the
+     * reader to its contents, like asn_parse_header does with datalength.
+     */
+    bool Enter( uint8_t &type ) {
+        size_t header, length;
+        if ( Remaining() < 2 ) {
+            return fail( ASN_ERR_SHORT );
+        }
+        if ( IS_EXTENSION_ID( *m_Pos ) ) {
+            return fail( ASN_ERR_TYPE );
+        }
+        if ( !readLength( header, length ) ) {
+            return false;
+        }
+        type = *m_Pos;
+        m_Pos += header;
+        m_End = m_Pos + length;
+        return true;
+    }
+
+    /** Enter() that also requires the element to be of expected_type. */
+    bool EnterSequence( uint8_t expected_type ) {
+        uint8_t type;
+        BerReader saved = *this;
+        if ( !Enter( type ) ) {
+            return false;
+        }
+        if ( type != expected_type ) {
+            *this = saved;
+            return fail( ASN_ERR_TYPE );
+        }
+        return true;
+    }
+
+    /**
+     * Moves to where inner, a copy of this reader that has since been
+     * entered and read from, stopped.
+     */
+    void ContinueAt( const BerReader &inner ) { m_Pos = inner.m_Pos; }
+
+    /** Reads the header of any element, returning its contents. */
+    bool ReadHeader( uint8_t &type, std::span<const uint8_t> &contents ) {
+        size_t header, length;
+        if ( Remaining() < 2 ) {
+            return fail( ASN_ERR_SHORT );
+        }
+        if ( IS_EXTENSION_ID( *m_Pos ) ) {
+            return fail( ASN_ERR_TYPE );
+        }
+        if ( !readLength( header, length ) ) {
+            return false;
+        }
+        type     = *m_Pos;
+        contents = { m_Pos + header, length };
+        m_Pos += header + length;
+        return true;
+    }
+
+    /** INTEGER, sign-extended; at most sizeof( T ) contents bytes. */
+    template <typename T>
+    bool ReadInteger( uint8_t &type, T &value ) {
+        static_assert( std::is_integral_v<T> && std::is_signed_v<T> );
+        std::span<const uint8_t> contents;
+        if ( !readTyped( type, contents, []( uint8_t t ) { return t == ASN_INTEGER; } ) ) {
+            return false;
+        }
+        if ( contents.empty() || contents.size() > sizeof( T ) ) {
+            return fail( ASN_ERR_LENGTH );
+        }
+        std::make_unsigned_t<T> v = ( contents[0] & 0x80 ) ? ~std::make_unsigned_t<T>() : 0;
+        for ( uint8_t b : contents ) {
+            v = ( v << 8 ) | b;
+        }
+        value = (T) v;
+        return commit( contents );
+    }
+
+    /**
+     * Counter32, Gauge32 or TimeTicks; at most sizeof( T ) contents bytes
+     * after an optional leading zero.
+     */
+    template <typename T>
+    bool ReadUnsigned( uint8_t &type, T &value ) {
+        static_assert( std::is_integral_v<T> && std::is_unsigned_v<T> );
+        std::span<const uint8_t> contents;
+        if ( !readTyped( type, contents, []( uint8_t t ) {
+                 return t == ASN_COUNTER || t == ASN_GAUGE || t == ASN_TIMETICKS;
+             } ) ) {
+            return false;
+        }
+        if ( contents.empty() || contents.size() > sizeof( T ) + 1
+             || ( contents.size() == sizeof( T ) + 1 && contents[0] != 0 ) ) {
+            return fail( ASN_ERR_LENGTH );
+        }
+        T v = 0;
+        for ( uint8_t b : contents ) {
+            v = ( v << 8 ) | b;
+        }
+        value = v;
+        return commit( contents );
+    }
+
+    /** Counter64, split into 32-bit halves as struct counter64 holds it. */
+    bool ReadCounter64( uint8_t &type, struct counter64 &value ) {
+        std::span<const uint8_t> contents;
+        if ( !readTyped( type, contents, []( uint8_t t ) { return t == ASN_COUNTER64; } ) ) {
+            return false;
+        }
+        if ( contents.size() > 9 || ( contents.size() == 9 && contents[0] != 0 ) ) {
+            return fail( ASN_ERR_LENGTH );
+        }
+        u_long low = 0, high = 0;
+        for ( uint8_t b : contents ) {
+            high = ( ( 0x00FFFFFF & high ) << 8 ) | ( ( low & 0xFF000000U ) >> 24 );
+            low  = ( ( low & 0x00FFFFFF ) << 8 ) | b;
+        }
+        value.low  = low;
+        value.high = high;
+        return commit( contents );
+    }
+
+    /** OCTET STRING or IpAddress, without copying. */
+    bool ReadString( uint8_t &type, std::span<const uint8_t> &value ) {
+        if ( !readTyped( type, value, []( uint8_t t ) { return t == ASN_OCTET_STR || t == ASN_IPADDRESS; } ) ) {
+            return false;
+        }
+        return commit( value );
+    }
+
+    /** BIT STRING, unused-bits octet included, without copying. */
+    bool ReadBitString( uint8_t &type, std::span<const uint8_t> &value ) {
+        if ( !readTyped( type, value, []( uint8_t t ) { return t == ASN_BIT_STR; } ) ) {
+            return false;
+        }
+        return commit( value );
+    }
+
+    /**
+     * OBJECT IDENTIFIER into objid, which has room for objidlen subids;
+     * objidlen is set to the number decoded.  Decodes as asn_parse_objid.
+     */
+    bool ReadObjid( uint8_t &type, oid *objid, size_t &objidlen ) {
+        std::span<const uint8_t> contents;
+        if ( !readTyped( type, contents, []( uint8_t t ) { return t == ASN_OBJECT_ID; } ) ) {
+            return false;
+        }
+
+        const uint8_t *bufp   = contents.data();
+        size_t         length = contents.size();
+        oid           *oidp   = objid + 1;
+        size_t         room   = objidlen - 1; /* the first subid expands to two */
+        u_long         subidentifier;
+
+        /* Handle invalid object identifier encodings of the form 06 00 robustly */
+        if ( length == 0 ) {
+            objid[0] = objid[1] = 0;
+        }
+
+        while ( length > 0 && room-- > 0 ) {
+            /*
+             * Most subids fit in one byte: when the next eight bytes all
+             * lack the continuation bit they are eight subids.
+             */
+            if ( length >= 8 && room >= 7 ) {
+                uint64_t word;
+                std::memcpy( &word, bufp, sizeof( word ) );
+                if ( !( word & 0x8080808080808080ULL ) ) {
+                    for ( size_t i = 0; i < 8; i++ ) {
+                        oidp[i] = bufp[i];
+                    }
+                    oidp += 8;
+                    bufp += 8;
+                    length -= 8;
+                    room -= 7;
+                    continue;
+                }
+            }
+
+            subidentifier = 0;
+            do { /* shift and add in low order 7 bits */
+                subidentifier = ( subidentifier << 7 ) + ( *bufp & ~ASN_BIT8 );
+                length--;
+            } while ( ( *bufp++ & ASN_BIT8 ) && length > 0 );
+
+            if ( length == 0 && ( bufp[-1] & ASN_BIT8 ) ) {
+                /* last byte has high bit set -> wrong BER encoded OID */
+                return fail( ASN_ERR_OID );
+            }
+            if ( subidentifier > MAX_SUBID ) {
+                return fail( ASN_ERR_OID );
+            }
+            *oidp++ = (oid) subidentifier;
+        }
+
+        if ( length || oidp < objid + 1 ) {
+            return fail( ASN_ERR_OID );
+        }
+
+        /* The first two subidentifiers are encoded as (X * 40) + Y */
+        subidentifier = oidp - objid >= 2 ? objid[1] : 0;
+        if ( subidentifier == 0x2B ) {
+            objid[0] = 1;
+            objid[1] = 3;
+        } else if ( subidentifier < 40 ) {
+            objid[0] = 0;
+            objid[1] = subidentifier;
+        } else if ( subidentifier < 80 ) {
+            objid[0] = 1;
+            objid[1] = subidentifier - 40;
+        } else {
+            objid[0] = 2;
+            objid[1] = subidentifier - 80;
+        }
+
+        objidlen = oidp - objid;
+        return commit( contents );
+    }
+
+private:
+    bool fail( int err_class ) {
+        m_Error = err_class;
+        return false;
+    }
+
+    /* Moves past an element whose contents were read. */
+    bool commit( std::span<const uint8_t> contents ) {
+        m_Pos = contents.data() + contents.size();
+        return true;
+    }
+
+    /*
+     * Decodes the length octets after the type at m_Pos, which must be
+     * followed by at least one byte.  header is the size of type and
+     * length octets; the contents must fit in the reader.
+     */
+    bool readLength( size_t &header, size_t &length ) {
+        const uint8_t *p     = m_Pos + 1;
+        size_t         avail = Remaining() - 1;
+
+        if ( *p & ASN_LONG_LEN ) {
+            size_t len_len = *p & ~ASN_LONG_LEN;
+            if ( len_len == 0 || len_len > sizeof( long ) || len_len + 1 > avail ) {
+                return fail( ASN_ERR_SHORT );
+            }
+            u_long value = 0;
+            for ( size_t i = 1; i <= len_len; i++ ) {
+                value = ( value << 8 ) | p[i];
+            }
+            if ( (long) value < 0 || value + len_len + 1 > avail ) {
+                return fail( ASN_ERR_SHORT );
+            }
+            header = len_len + 2;
+            length = value;
+        } else {
+            if ( *p + 1U > avail ) {
+                return fail( ASN_ERR_SHORT );
+            }
+            header = 2;
+            length = *p;
+        }
+        return true;
+    }
+
+    /* Header of a primitive element whose type satisfies accept. */
+    template <typename Accept>
+    bool readTyped( uint8_t &type, std::span<const uint8_t> &contents, Accept accept ) {
+        size_t header, length;
+        if ( Remaining() < 2 ) {
+            return fail( ASN_ERR_SHORT );
+        }
+        type = *m_Pos;
+        if ( !accept( type ) ) {
+            return fail( ASN_ERR_TYPE );
+        }
+        if ( !readLength( header, length ) ) {
+            return false;
+        }
+        contents = { m_Pos + header, length };
+        return true;
+    }
+
+    const uint8_t *m_Pos;
+    const uint8_t *m_End;
+    int            m_Error = -1;
+};
+
+#endif // SNMP_SHARED_LIB_BER_READER_H
@@ -0,0 +1,191 @@
+#include "columnar_sink.h"
+#include "snmp_probes.h"
+
+#include <bit>
+
+static_assert( std::endian::native == std::endian::little, "columnar sink writes host-order integers" );
+
+/* Start a new dictionary once this many OIDs have been seen. */
+static const size_t MAX_DICTIONARY_ENTRIES = 1 << 20;
+
+static const char FILE_MAGIC[8]  = { 'S', 'N', 'M', 'P', 'C', 'O', 'L', '1' };
+static const char BATCH_MAGIC[4] = { 'B', 'T', 'C', 'H' };
+
+/* Returns the bytes written, padding included. */
+template <typename T>
+static size_t
+write_column( std::ofstream &out, const T *data, size_t count, const std::string *bytes = nullptr ) {
+    static const char zeros[8] = {};
+    uint64_t          length   = count * sizeof( T ) + ( bytes ? bytes->size() : 0 );
+    out.write( reinterpret_cast<const char *>( &length ), sizeof( length ) );
+    out.write( reinterpret_cast<const char *>( data ), count * sizeof( T ) );
+    if ( bytes ) {
+        out.write( bytes->data(), bytes->size() );
+    }
+    out.write( zeros, ( 8 - length % 8 ) % 8 );
+    return sizeof( length ) + ( length + 7 ) / 8 * 8;
+}
+
+size_t ColumnarTrapSink::OidHash::operator()( const std::vector<oid> &name ) const {
+    size_t h = name.size();
+    for ( oid subid : name ) {
+        h = h * 31 + subid;
+    }
+    return h;
+}
+
+ColumnarTrapSink::ColumnarTrapSink( std::string path, size_t batch_rows, std::chrono::milliseconds flush_interval )
+        : m_Path( std::move( path ) ), m_BatchRows( batch_rows ? batch_rows : 1 ), m_FlushInterval( flush_interval ) {
+    clearBatch();
+}
+
+ColumnarTrapSink::~ColumnarTrapSink() {
+    if ( m_Thread.joinable() ) {
+        {
+            std::lock_guard<std::mutex> lock( m_Mutex );
+            m_Stop = true;
+        }
+        m_Wake.notify_one();
+        m_Thread.join();
+    }
+    if ( m_Output.is_open() ) {
+        Flush();
+        m_Output.close();
+    }
+}
+
+bool ColumnarTrapSink::Open() {
+    m_Output.open( m_Path, std::ios::out | std::ios::binary | std::ios::app );
+    if ( !m_Output.is_open() ) {
+        return false;
+    }
+    if ( m_Output.tellp() == 0 ) {
+        m_Output.write( FILE_MAGIC, sizeof( FILE_MAGIC ) );
+    } else {
+        /* the ids of the batches already in the file are not known here */
+        m_DictReset = true;
+    }
+    if ( !m_Output.good() ) {
+        return false;
+    }
+    if ( m_FlushInterval.count() > 0 ) {
+        m_Thread = std::thread( &ColumnarTrapSink::run, this );
+    }
+    return true;
+}
+
+/* Writes out a batch that waited flush_interval when no row came to do it. */
+void ColumnarTrapSink::run() {
+    std::unique_lock<std::mutex> lock( m_Mutex );
+    while ( !m_Stop ) {
+        auto deadline = ( m_Ts.empty() ? std::chrono::steady_clock::now() : m_BatchStarted ) + m_FlushInterval;
+        if ( m_Wake.wait_until( lock, deadline, [this] { return m_Stop; } ) ) {
+            break;
+        }
+        if ( !m_Ts.empty() && std::chrono::steady_clock::now() - m_BatchStarted >= m_FlushInterval ) {
+            flushBatch();
+        }
+    }
+}
+
+uint32_t ColumnarTrapSink::dictionaryId( std::span<const oid> name ) {
+    auto [it, inserted] = m_Dictionary.try_emplace( std::vector<oid>( name.begin(), name.end() ),
+                                                    (uint32_t) m_Dictionary.size() );
+    if ( inserted ) {
+        m_DictPending.push_back( (uint32_t) name.size() );
+        for ( oid subid : name ) {
+            m_DictPending.push_back( (uint32_t) subid );
+        }
+        m_DictPendingCount++;
+    }
+    return it->second;
+}
+
+void ColumnarTrapSink::Append( std::chrono::system_clock::time_point received, const std::string &source_ip,
+                               const TrapRecord &record ) {
+    std::lock_guard<std::mutex> lock( m_Mutex );
+    if ( m_Ts.empty() ) {
+        m_BatchStarted = std::chrono::steady_clock::now();
+    }
+
+    m_Ts.push_back( std::chrono::duration_cast<std::chrono::microseconds>( received.time_since_epoch() ).count() );
+    m_SrcIp += source_ip;
+    m_SrcIpOffsets.push_back( (uint32_t) m_SrcIp.size() );
+    m_TrapOid.push_back( record.GetTrapOid().empty() ? NO_OID : dictionaryId( record.GetTrapOid() ) );
+
+    for ( const TrapVarBind &vb : record.GetVarBinds() ) {
+        int64_t number = 0;
+        if ( auto *v = std::get_if<long>( &vb.value ) ) {
+            number = *v;
+        } else if ( auto *v = std::get_if<uint32_t>( &vb.value ) ) {
+            number = *v;
+        } else if ( auto *v = std::get_if<uint64_t>( &vb.value ) ) {
+            number = (int64_t) *v;
+        } else if ( auto *v = std::get_if<std::span<const oid>>( &vb.value ) ) {
+            number = dictionaryId( *v );
+        } else if ( auto *v = std::get_if<std::span<const u_char>>( &vb.value ) ) {
+            m_VbBytes.append( reinterpret_cast<const char *>( v->data() ), v->size() );
+        }
+        m_VbOid.push_back( dictionaryId( vb.name ) );
+        m_VbType.push_back( vb.type );
+        m_VbInt.push_back( number );
+        m_VbBytesOffsets.push_back( (uint32_t) m_VbBytes.size() );
+    }
+    m_VbOffsets.push_back( (uint32_t) m_VbOid.size() );
+
+    if ( m_Ts.size() >= m_BatchRows || std::chrono::steady_clock::now() - m_BatchStarted >= m_FlushInterval ) {
+        flushBatch();
+    }
+}
+
+bool ColumnarTrapSink::Flush() {
+    std::lock_guard<std::mutex> lock( m_Mutex );
+    return flushBatch();
+}
+
+bool ColumnarTrapSink::flushBatch() {
+    if ( m_Ts.empty() || !m_Output.is_open() ) {
+        return true;
+    }
+
+    uint32_t header[4] = { m_DictReset ? BATCH_DICT_RESET : 0, (uint32_t) m_Ts.size(), (uint32_t) m_VbOid.size(),
+                           m_DictPendingCount };
+    m_Output.write( BATCH_MAGIC, sizeof( BATCH_MAGIC ) );
+    m_Output.write( reinterpret_cast<const char *>( header ), sizeof( header ) );
+    m_Output.write( reinterpret_cast<const char *>( m_DictPending.data() ), m_DictPending.size() * sizeof( uint32_t ) );
+
+    size_t written = sizeof( BATCH_MAGIC ) + sizeof( header ) + m_DictPending.size() * sizeof( uint32_t );
+    written += write_column( m_Output, m_Ts.data(), m_Ts.size() );
+    written += write_column( m_Output, m_SrcIpOffsets.data(), m_SrcIpOffsets.size(), &m_SrcIp );
+    written += write_column( m_Output, m_TrapOid.data(), m_TrapOid.size() );
+    written += write_column( m_Output, m_VbOffsets.data(), m_VbOffsets.size() );
+    written += write_column( m_Output, m_VbOid.data(), m_VbOid.size() );
+    written += write_column( m_Output, m_VbType.data(), m_VbType.size() );
+    written += write_column( m_Output, m_VbInt.data(), m_VbInt.size() );
+    written += write_column( m_Output, m_VbBytesOffsets.data(), m_VbBytesOffsets.size(), &m_VbBytes );
+    m_Output.flush();
+    SNMP_PROBE3( sink_write, "columnar", m_Ts.size(), written );
+
+    m_DictReset = false;
+    if ( m_Dictionary.size() >= MAX_DICTIONARY_ENTRIES ) {
+        m_Dictionary.clear();
+        m_DictReset = true;
+    }
+    clearBatch();
+    return m_Output.good();
+}
+
+void ColumnarTrapSink::clearBatch() {
+    m_DictPending.clear();
+    m_DictPendingCount = 0;
+    m_Ts.clear();
+    m_SrcIpOffsets.assign( 1, 0 );
+    m_SrcIp.clear();
+    m_TrapOid.clear();
+    m_VbOffsets.assign( 1, 0 );
+    m_VbOid.clear();
+    m_VbType.clear();
+    m_VbInt.clear();
+    m_VbBytesOffsets.assign( 1, 0 );
+    m_VbBytes.clear();
+}
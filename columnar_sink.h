@@ -0,0 +1,105 @@
+#ifndef SNMP_SHARED_LIB_COLUMNAR_SINK_H
+#define SNMP_SHARED_LIB_COLUMNAR_SINK_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "trap_record.h"
+
+/**
+ * Accumulates decoded traps in column batches and appends them to a file.
+ *
+ * File layout, all integers little-endian:
+ *
+ *   file   := "SNMPCOL1" batch*
+ *   batch  := "BTCH" u32 flags u32 rows u32 varbinds u32 dict_entries
+ *             dict_entry{dict_entries} column{8}
+ *   dict_entry := u32 subid_count u32 subid{subid_count}
+ *   column := u64 byte_length byte{byte_length} pad-to-8
+ *
+ * Columns, in order:
+ *   ts          i64[rows]          receive time, microseconds since epoch
+ *   src_ip      u32[rows+1] bytes  offsets then UTF-8 text
+ *   trap_oid    u32[rows]          dictionary id, 0xffffffff if none
+ *   vb_offsets  u32[rows+1]        first varbind of each row
+ *   vb_oid      u32[varbinds]      dictionary id of the varbind name
+ *   vb_type     u8[varbinds]       ASN type
+ *   vb_int      i64[varbinds]      numeric value; dictionary id for OIDs
+ *   vb_bytes    u32[varbinds+1] bytes  octet string values
+ *
+ * OIDs are dictionary-encoded across the whole file: each batch carries
+ * only the entries it added, numbered after those already written.  When
+ * the BATCH_DICT_RESET flag is set the dictionary starts over at id 0,
+ * as it does in the first batch appended to a file that was not empty.
+ *
+ * A batch is written once it has batch_rows rows or its first row has
+ * waited flush_interval, by a thread of the sink's own when no row comes
+ * to do it.
+ */
+class ColumnarTrapSink {
+public:
+    static constexpr uint32_t BATCH_DICT_RESET = 0x1;
+    static constexpr uint32_t NO_OID           = 0xffffffff;
+
+    ColumnarTrapSink( std::string path, size_t batch_rows, std::chrono::milliseconds flush_interval );
+    ~ColumnarTrapSink();
+
+    ColumnarTrapSink( const ColumnarTrapSink & )            = delete;
+    ColumnarTrapSink &operator=( const ColumnarTrapSink & ) = delete;
+
+    /** Opens the file and starts the flush thread. */
+    bool Open();
+
+    /** Adds a row, writing the batch out once a threshold is crossed. */
+    void Append( std::chrono::system_clock::time_point received, const std::string &source_ip, const TrapRecord &record );
+
+    /** Writes the pending rows, if any. */
+    bool Flush();
+
+private:
+    struct OidHash {
+        size_t operator()( const std::vector<oid> &name ) const;
+    };
+
+    void     run();
+    bool     flushBatch();
+    uint32_t dictionaryId( std::span<const oid> name );
+    void     clearBatch();
+
+    std::string               m_Path;
+    size_t                    m_BatchRows;
+    std::chrono::milliseconds m_FlushInterval;
+    std::ofstream             m_Output;
+
+    std::chrono::steady_clock::time_point m_BatchStarted;
+
+    std::mutex              m_Mutex; // the batch, the dictionary and the file
+    std::condition_variable m_Wake;
+    bool                    m_Stop = false;
+    std::thread             m_Thread;
+
+    std::unordered_map<std::vector<oid>, uint32_t, OidHash> m_Dictionary;
+    std::vector<uint32_t>                                   m_DictPending; // subid_count, subids... per new entry
+    uint32_t                                                m_DictPendingCount = 0;
+    bool                                                    m_DictReset        = false;
+
+    std::vector<int64_t>  m_Ts;
+    std::vector<uint32_t> m_SrcIpOffsets;
+    std::string           m_SrcIp;
+    std::vector<uint32_t> m_TrapOid;
+    std::vector<uint32_t> m_VbOffsets;
+    std::vector<uint32_t> m_VbOid;
+    std::vector<uint8_t>  m_VbType;
+    std::vector<int64_t>  m_VbInt;
+    std::vector<uint32_t> m_VbBytesOffsets;
+    std::string           m_VbBytes;
+};
+
+#endif // SNMP_SHARED_LIB_COLUMNAR_SINK_H
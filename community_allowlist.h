@@ -0,0 +1,104 @@
+#ifndef SNMP_SHARED_LIB_COMMUNITY_ALLOWLIST_H
+#define SNMP_SHARED_LIB_COMMUNITY_ALLOWLIST_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+/**
+ * The community strings traps are accepted with, looked up straight from
+ * the packet bytes.  Counts the traps seen with each, and those rejected,
+ * in total and by the community they came with, so that stray or hostile
+ * senders show up; only the first MAX_REJECTED_COMMUNITIES distinct
+ * values are kept, so that a sender cycling through values cannot grow
+ * the table without bound.
+ *
+ * Communities are shared secrets, so the counts of those allowed are
+ * handed out by their position in the allowlist rather than by value.
+ *
+ * The counts can be read while another thread accepts traps; communities
+ * are only added while none are.
+ */
+class CommunityAllowlist {
+public:
+    static constexpr size_t MAX_REJECTED_COMMUNITIES = 64;
+
+    void Add( std::string community ) { m_Communities.try_emplace( std::move( community ), m_Communities.size() ); }
+
+    void Clear() {
+        m_Communities.clear();
+        m_Rejected.store( 0, std::memory_order_relaxed );
+        std::lock_guard<std::mutex> lock( m_RejectedMutex );
+        m_RejectedBy.clear();
+    }
+
+    bool Empty() const { return m_Communities.empty(); }
+
+    /** Whether community is allowed; counts it either way. */
+    bool Accept( std::span<const uint8_t> community ) {
+        std::string_view name( reinterpret_cast<const char *>( community.data() ), community.size() );
+        auto             it = m_Communities.find( name );
+        if ( it == m_Communities.end() ) {
+            reject( name );
+            return false;
+        }
+        it->second.accepted.fetch_add( 1, std::memory_order_relaxed );
+        return true;
+    }
+
+    /** Traps accepted per community, by the position it was added at. */
+    template <typename F>
+    void ForEach( F &&f ) const {
+        for ( const auto &[community, entry] : m_Communities ) {
+            f( entry.position, entry.accepted.load( std::memory_order_relaxed ) );
+        }
+    }
+
+    /** Traps rejected per community, for the values kept. */
+    template <typename F>
+    void ForEachRejected( F &&f ) const {
+        std::lock_guard<std::mutex> lock( m_RejectedMutex );
+        for ( const auto &[community, rejected] : m_RejectedBy ) {
+            f( community, rejected );
+        }
+    }
+
+    uint64_t GetRejected() const { return m_Rejected.load( std::memory_order_relaxed ); }
+
+private:
+    struct Entry {
+        explicit Entry( size_t position ) : position( position ) {}
+
+        size_t                position;
+        std::atomic<uint64_t> accepted{ 0 };
+    };
+
+    struct Hash {
+        using is_transparent = void;
+        size_t operator()( std::string_view s ) const { return std::hash<std::string_view>()( s ); }
+    };
+
+    void reject( std::string_view community ) {
+        m_Rejected.fetch_add( 1, std::memory_order_relaxed );
+        std::lock_guard<std::mutex> lock( m_RejectedMutex );
+        auto                        it = m_RejectedBy.find( community );
+        if ( it != m_RejectedBy.end() ) {
+            it->second++;
+        } else if ( m_RejectedBy.size() < MAX_REJECTED_COMMUNITIES ) {
+            m_RejectedBy.emplace( community, 1 );
+        }
+    }
+
+    std::unordered_map<std::string, Entry, Hash, std::equal_to<>> m_Communities;
+    std::atomic<uint64_t>                                          m_Rejected{ 0 };
+
+    mutable std::mutex                                                m_RejectedMutex;
+    std::unordered_map<std::string, uint64_t, Hash, std::equal_to<>> m_RejectedBy;
+};
+
+#endif // SNMP_SHARED_LIB_COMMUNITY_ALLOWLIST_H
@@ -0,0 +1,80 @@
+#ifndef SNMP_SHARED_LIB_DATAGRAM_CONTROL_H
+#define SNMP_SHARED_LIB_DATAGRAM_CONTROL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <span>
+
+#include <netinet/in.h>
+#include <netinet/udp.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+
+#ifndef UDP_GRO
+#define UDP_GRO 104
+#endif
+
+/**
+ * What the ancillary data received with a datagram says about it.
+ */
+struct DatagramControl {
+    /* Room recvmsg needs for all the control messages asked for. */
+    static constexpr size_t SPACE = CMSG_SPACE( sizeof( int ) ) + CMSG_SPACE( sizeof( uint32_t ) )
+                                  + CMSG_SPACE( sizeof( timespec ) ) + CMSG_SPACE( sizeof( in6_pktinfo ) );
+
+    /* With UDP_GRO: the buffer holds datagrams coalesced in segments of this size. */
+    size_t gro_segment_size = 0;
+
+    /* With SO_RXQ_OVFL: datagrams the socket had dropped when this one was queued. */
+    uint32_t drops = 0;
+
+    /* With SO_TIMESTAMPNS: when the kernel received it, CLOCK_REALTIME nanoseconds. */
+    int64_t received_ns = 0;
+
+    /* With IP_PKTINFO or IPV6_RECVPKTINFO: the address it was sent to, AF_UNSPEC if not told. */
+    sa_family_t local_family = AF_UNSPEC;
+    union {
+        in_addr  v4;
+        in6_addr v6;
+    } local_address{};
+
+    static DatagramControl Parse( const msghdr &msg ) {
+        DatagramControl control;
+        for ( const cmsghdr *cmsg = CMSG_FIRSTHDR( &msg ); cmsg; cmsg = CMSG_NXTHDR( (msghdr *) &msg, (cmsghdr *) cmsg ) ) {
+            if ( cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO ) {
+                int size;
+                memcpy( &size, CMSG_DATA( cmsg ), sizeof( size ) );
+                control.gro_segment_size = size > 0 ? size : 0;
+            } else if ( cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SO_RXQ_OVFL ) {
+                /* only sent once there were drops */
+                memcpy( &control.drops, CMSG_DATA( cmsg ), sizeof( control.drops ) );
+            } else if ( cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPNS ) {
+                timespec ts;
+                memcpy( &ts, CMSG_DATA( cmsg ), sizeof( ts ) );
+                control.received_ns = (int64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+            } else if ( cmsg->cmsg_level == IPPROTO_IP && cmsg->cmsg_type == IP_PKTINFO ) {
+                in_pktinfo info;
+                memcpy( &info, CMSG_DATA( cmsg ), sizeof( info ) );
+                control.local_family     = AF_INET;
+                control.local_address.v4 = info.ipi_addr;
+            } else if ( cmsg->cmsg_level == IPPROTO_IPV6 && cmsg->cmsg_type == IPV6_PKTINFO ) {
+                in6_pktinfo info;
+                memcpy( &info, CMSG_DATA( cmsg ), sizeof( info ) );
+                control.local_family     = AF_INET6;
+                control.local_address.v6 = info.ipi6_addr;
+            }
+        }
+        return control;
+    }
+
+    static DatagramControl Parse( std::span<const u_char> data ) {
+        msghdr msg{};
+        msg.msg_control    = (void *) data.data();
+        msg.msg_controllen = data.size();
+        return Parse( msg );
+    }
+};
+
+#endif // SNMP_SHARED_LIB_DATAGRAM_CONTROL_H
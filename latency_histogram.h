@@ -0,0 +1,95 @@
+#ifndef SNMP_SHARED_LIB_LATENCY_HISTOGRAM_H
+#define SNMP_SHARED_LIB_LATENCY_HISTOGRAM_H
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+#include "thread_counters.h"
+
+/**
+ * Histogram of nanosecond durations in HDR-style log-linear buckets:
+ * every power of two is split into 16 buckets, so a value is known to
+ * within 1/16 of itself at any magnitude, from 1 ns to the full range of
+ * uint64_t, in a fixed 976 counters.
+ *
+ * The counts are ThreadCounters, so recording is lock-free from any
+ * number of threads.  Percentiles are reported as the upper bound of the
+ * bucket they fall in, never below the true value.
+ */
+class LatencyHistogram {
+public:
+    static constexpr unsigned SUB_BITS = 4;
+    static constexpr size_t   SUB      = size_t( 1 ) << SUB_BITS;
+    static constexpr size_t   BUCKETS  = ( 64 - SUB_BITS + 1 ) * SUB;
+
+    struct Summary {
+        uint64_t count;
+        uint64_t p50;
+        uint64_t p99;
+        uint64_t p999;
+        uint64_t max;
+    };
+
+    void Record( uint64_t ns ) { m_Counts.Add( Bucket( ns ) ); }
+
+    /** Everything recorded so far; all zero if nothing was. */
+    Summary Summarize() const {
+        std::array<uint64_t, BUCKETS> counts = m_Counts.Read();
+        Summary                       summary{};
+        for ( uint64_t count : counts ) {
+            summary.count += count;
+        }
+        if ( summary.count == 0 ) {
+            return summary;
+        }
+        /* ranks are rounded up, so p99.9 of fewer than 1000 values is the max */
+        const uint64_t p50  = ( summary.count * 500 + 999 ) / 1000;
+        const uint64_t p99  = ( summary.count * 990 + 999 ) / 1000;
+        const uint64_t p999 = ( summary.count * 999 + 999 ) / 1000;
+        uint64_t       seen = 0;
+        for ( size_t b = 0; b < BUCKETS; b++ ) {
+            if ( counts[b] == 0 ) {
+                continue;
+            }
+            uint64_t before = seen;
+            seen += counts[b];
+            if ( before < p50 && seen >= p50 ) {
+                summary.p50 = Upper( b );
+            }
+            if ( before < p99 && seen >= p99 ) {
+                summary.p99 = Upper( b );
+            }
+            if ( before < p999 && seen >= p999 ) {
+                summary.p999 = Upper( b );
+            }
+            summary.max = Upper( b );
+        }
+        return summary;
+    }
+
+    /* Values below SUB get a bucket each; above, the top SUB_BITS + 1 bits pick it. */
+    static size_t Bucket( uint64_t ns ) {
+        if ( ns < SUB ) {
+            return ns;
+        }
+        unsigned exponent = 63 - std::countl_zero( ns );
+        return ( exponent - SUB_BITS + 1 ) * SUB + ( ( ns >> ( exponent - SUB_BITS ) ) & ( SUB - 1 ) );
+    }
+
+    static uint64_t Lower( size_t bucket ) {
+        if ( bucket < SUB ) {
+            return bucket;
+        }
+        unsigned exponent = bucket / SUB + SUB_BITS - 1;
+        return ( SUB + bucket % SUB ) << ( exponent - SUB_BITS );
+    }
+
+    static uint64_t Upper( size_t bucket ) { return bucket + 1 < BUCKETS ? Lower( bucket + 1 ) - 1 : UINT64_MAX; }
+
+private:
+    ThreadCounters<BUCKETS> m_Counts;
+};
+
+#endif // SNMP_SHARED_LIB_LATENCY_HISTOGRAM_H
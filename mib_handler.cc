@@ -1,7 +1,13 @@
 #include "mib_handler.h"
+#include "string_kernels.h"
+#include "snmp_probes.h"
 
 #include <iostream>
 
+static int oid_output_format = NETSNMP_OID_OUTPUT_MODULE; /* see netsnmp_set_oid_output_format() */
+static struct oid_output_override *oid_output_overrides;
+static char *gLoadedMibDir;     /* directory the tree was built from */
+
 /*
  * Copies src to the dest buffer. The copy will never overflow the dest buffer
  * and dest will always be null terminated, len is the size of the dest buffer.
@@ -261,40 +267,37 @@ which_module(const char *name) {
     return (-1);
 }
 
-/**
- * Prints an integer according to the hint into a buffer.
- *
- * If allow_realloc is true the buffer will be (re)allocated to fit in the
- * needed size. (Note: *buf may change due to this.)
- *
- * @param buf      Address of the buffer to print to.
- * @param buf_len  Address to an integer containing the size of buf.
- * @param out_len  Incremented by the number of characters printed.
- * @param allow_realloc if not zero reallocate the buffer to fit the
- *                      needed size.
- * @param val      The variable to encode.
- * @param decimaltype 'd' or 'u' depending on integer type
- * @param hint     Contents of the DISPLAY-HINT clause of the MIB.
- *                 See RFC 1903 Section 3.1 for details. may _NOT_ be NULL.
- * @param units    Contents of the UNITS clause of the MIB. may be NULL.
- *
- * @return 1 on success, or 0 on failure (out of memory, or buffer to
- *         small when not allowed to realloc.)
+/*
+ * Fills dh with the integer part of a DISPLAY-HINT clause, which is all
+ * the integer printers need: no octet-format specifications are parsed.
  */
-int
-sprint_realloc_hinted_integer(u_char **buf, size_t *buf_len,
-                              size_t *out_len, int allow_realloc,
-                              long val, const char decimaltype,
-                              const char *hint, const char *units) {
+static const struct display_hint *
+integer_display_hint(struct display_hint *dh, const char *hint) {
+    if (!hint)
+        return NULL;
+    memset(dh, 0, sizeof(*dh));
+    dh->text = hint;
+    dh->int_code = hint[0];
+    if (hint[0] == 'd' && hint[1] == '-')
+        dh->int_shift = atoi(hint + 2);
+    return dh;
+}
+
+/*
+ * sprint_realloc_hinted_integer() for an already compiled hint.
+ */
+static int
+sprint_realloc_integer_program(u_char **buf, size_t *buf_len,
+                               size_t *out_len, int allow_realloc,
+                               long val, const char decimaltype,
+                               const struct display_hint *hint) {
     char fmt[10] = "%l@", tmp[256];
-    int shift = 0, len, negative = 0;
+    int shift = hint->int_shift, len, negative = 0;
 
-    if (hint[0] == 'd') {
+    if (hint->int_code == 'd') {
         /*
          * We might *actually* want a 'u' here.
          */
-        if (hint[1] == '-')
-            shift = atoi(hint + 2);
         fmt[2] = decimaltype;
         if (val < 0) {
             negative = 1;
@@ -304,10 +307,10 @@ sprint_realloc_hinted_integer(u_char **buf, size_t *buf_len,
         /*
          * DISPLAY-HINT character is 'b', 'o', or 'x'.
          */
-        fmt[2] = hint[0];
+        fmt[2] = hint->int_code;
     }
 
-    if (hint[0] == 'b') {
+    if (hint->int_code == 'b') {
         unsigned long int bit = 0x80000000LU;
         char *bp = tmp;
         while (bit) {
@@ -351,9 +354,8 @@ sprint_realloc_hinted_integer(u_char **buf, size_t *buf_len,
     return snmp_strcat(buf, buf_len, out_len, allow_realloc, (u_char *) tmp);
 }
 
-
 /**
- * Prints an integer into a buffer.
+ * Prints an integer according to the hint into a buffer.
  *
  * If allow_realloc is true the buffer will be (re)allocated to fit in the
  * needed size. (Note: *buf may change due to this.)
@@ -363,28 +365,41 @@ sprint_realloc_hinted_integer(u_char **buf, size_t *buf_len,
  * @param out_len  Incremented by the number of characters printed.
  * @param allow_realloc if not zero reallocate the buffer to fit the
  *                      needed size.
- * @param var      The variable to encode.
- * @param enums    The enumeration ff this variable is enumerated. may be NULL.
+ * @param val      The variable to encode.
+ * @param decimaltype 'd' or 'u' depending on integer type
  * @param hint     Contents of the DISPLAY-HINT clause of the MIB.
- *                 See RFC 1903 Section 3.1 for details. may be NULL.
+ *                 See RFC 1903 Section 3.1 for details. may _NOT_ be NULL.
  * @param units    Contents of the UNITS clause of the MIB. may be NULL.
  *
  * @return 1 on success, or 0 on failure (out of memory, or buffer to
  *         small when not allowed to realloc.)
  */
 int
-sprint_realloc_integer(u_char **buf, size_t *buf_len, size_t *out_len,
-                       int allow_realloc,
-                       const netsnmp_variable_list *var,
-                       const struct enum_list *enums,
-                       const char *hint, const char *units) {
-    char *enum_string = NULL;
+sprint_realloc_hinted_integer(u_char **buf, size_t *buf_len,
+                              size_t *out_len, int allow_realloc,
+                              long val, const char decimaltype,
+                              const char *hint, const char *units) {
+    struct display_hint dh;
 
-    if (var->type != ASN_INTEGER) {
-        return sprint_realloc_by_type(buf, buf_len, out_len,
-                                      allow_realloc, var, NULL, NULL,
-                                      NULL);
-    }
+    (void) units;               /* the callers append UNITS themselves */
+    return sprint_realloc_integer_program(buf, buf_len, out_len,
+                                          allow_realloc, val, decimaltype,
+                                          integer_display_hint(&dh, hint));
+}
+
+
+/*
+ * sprint_realloc_integer() for an already compiled hint; var must be
+ * of type ASN_INTEGER.
+ */
+static int
+sprint_realloc_integer_hinted(u_char **buf, size_t *buf_len, size_t *out_len,
+                              int allow_realloc,
+                              const netsnmp_variable_list *var,
+                              const struct enum_list *enums,
+                              const struct display_hint *hint,
+                              const char *units) {
+    char *enum_string = NULL;
 
     for (; enums; enums = enums->next) {
         if (enums->value == *var->val.integer) {
@@ -400,10 +415,10 @@ sprint_realloc_integer(u_char **buf, size_t *buf_len, size_t *out_len,
 
     if (enum_string == NULL) {
         if (hint) {
-            if (!(sprint_realloc_hinted_integer(buf, buf_len, out_len,
-                                                allow_realloc,
-                                                *var->val.integer, 'd',
-                                                hint, units))) {
+            if (!(sprint_realloc_integer_program(buf, buf_len, out_len,
+                                                 allow_realloc,
+                                                 *var->val.integer, 'd',
+                                                 hint))) {
                 return 0;
             }
         } else {
@@ -439,6 +454,46 @@ sprint_realloc_integer(u_char **buf, size_t *buf_len, size_t *out_len,
     return 1;
 }
 
+/**
+ * Prints an integer into a buffer.
+ *
+ * If allow_realloc is true the buffer will be (re)allocated to fit in the
+ * needed size. (Note: *buf may change due to this.)
+ *
+ * @param buf      Address of the buffer to print to.
+ * @param buf_len  Address to an integer containing the size of buf.
+ * @param out_len  Incremented by the number of characters printed.
+ * @param allow_realloc if not zero reallocate the buffer to fit the
+ *                      needed size.
+ * @param var      The variable to encode.
+ * @param enums    The enumeration ff this variable is enumerated. may be NULL.
+ * @param hint     Contents of the DISPLAY-HINT clause of the MIB.
+ *                 See RFC 1903 Section 3.1 for details. may be NULL.
+ * @param units    Contents of the UNITS clause of the MIB. may be NULL.
+ *
+ * @return 1 on success, or 0 on failure (out of memory, or buffer to
+ *         small when not allowed to realloc.)
+ */
+int
+sprint_realloc_integer(u_char **buf, size_t *buf_len, size_t *out_len,
+                       int allow_realloc,
+                       const netsnmp_variable_list *var,
+                       const struct enum_list *enums,
+                       const char *hint, const char *units) {
+    struct display_hint dh;
+
+    if (var->type != ASN_INTEGER) {
+        return sprint_realloc_by_type(buf, buf_len, out_len,
+                                      allow_realloc, var, NULL, NULL,
+                                      NULL);
+    }
+
+    return sprint_realloc_integer_hinted(buf, buf_len, out_len, allow_realloc,
+                                         var, enums,
+                                         integer_display_hint(&dh, hint),
+                                         units);
+}
+
 /**
  * Prints an ascii string into a buffer.
  *
@@ -462,35 +517,16 @@ int
 sprint_realloc_asciistring(u_char **buf, size_t *buf_len,
                            size_t *out_len, int allow_realloc,
                            const u_char *cp, size_t len) {
-    int i;
-
-    for (i = 0; i < (int) len; i++) {
-        if (isprint(*cp) || isspace(*cp)) {
-            if (*cp == '\\' || *cp == '"') {
-                if ((*out_len >= *buf_len) &&
-                    !(allow_realloc && snmp_realloc(buf, buf_len))) {
-                    return 0;
-                }
-                *(*buf + (*out_len)++) = '\\';
-            }
-            if ((*out_len >= *buf_len) &&
-                !(allow_realloc && snmp_realloc(buf, buf_len))) {
-                return 0;
-            }
-            *(*buf + (*out_len)++) = *cp++;
-        } else {
-            if ((*out_len >= *buf_len) &&
-                !(allow_realloc && snmp_realloc(buf, buf_len))) {
-                return 0;
-            }
-            *(*buf + (*out_len)++) = '.';
-            cp++;
+    /*
+     * Every octet expands to at most two characters, so reserve the worst
+     * case once and let the kernel write without per-octet checks.
+     */
+    while ((*out_len + 2 * len + 1) >= *buf_len) {
+        if (!(allow_realloc && snmp_realloc(buf, buf_len))) {
+            return 0;
         }
     }
-    if ((*out_len >= *buf_len) &&
-        !(allow_realloc && snmp_realloc(buf, buf_len))) {
-        return 0;
-    }
+    *out_len += octet_string_escape_ascii(*buf + *out_len, cp, len);
     *(*buf + *out_len) = '\0';
     return 1;
 }
@@ -535,10 +571,6 @@ sprint_char(char *buf, const u_char ch) {
 int
 _sprint_hexstring_line(u_char **buf, size_t *buf_len, size_t *out_len,
                        int allow_realloc, const u_char *cp, size_t line_len) {
-    const u_char *tp;
-    const u_char *cp2 = cp;
-    size_t lenleft = line_len;
-
     /*
      * Make sure there's enough room for the hex output....
      */
@@ -551,17 +583,8 @@ _sprint_hexstring_line(u_char **buf, size_t *buf_len, size_t *out_len,
     /*
      * .... and display the hex values themselves....
      */
-    for (; lenleft >= 8; lenleft -= 8) {
-        sprintf((char *) (*buf + *out_len),
-                "%02X %02X %02X %02X %02X %02X %02X %02X ", cp[0], cp[1],
-                cp[2], cp[3], cp[4], cp[5], cp[6], cp[7]);
-        *out_len += strlen((char *) (*buf + *out_len));
-        cp += 8;
-    }
-    for (; lenleft > 0; lenleft--) {
-        sprintf((char *) (*buf + *out_len), "%02X ", *cp++);
-        *out_len += strlen((char *) (*buf + *out_len));
-    }
+    *out_len += octet_string_to_hex(*buf + *out_len, cp, line_len);
+    *(*buf + *out_len) = '\0';
 
     return 1;
 }
@@ -589,195 +612,402 @@ sprint_realloc_hexstring(u_char **buf, size_t *buf_len, size_t *out_len,
 
 
 /**
- * Prints an octet string into a buffer.
+ * Parses a DISPLAY-HINT clause into a struct display_hint.
  *
- * The variable var is encoded as octet string.
+ * The octet-format specifications are read exactly as the RFC 2579
+ * interpreter used to read them on every call; the result is run by
+ * sprint_realloc_hint_program().  Clauses of the common textual conventions
+ * are tagged so that they get a dedicated formatter.
  *
- * If allow_realloc is true the buffer will be (re)allocated to fit in the
- * needed size. (Note: *buf may change due to this.)
- *
- * @param buf      Address of the buffer to print to.
- * @param buf_len  Address to an integer containing the size of buf.
- * @param out_len  Incremented by the number of characters printed.
- * @param allow_realloc if not zero reallocate the buffer to fit the
- *                      needed size.
- * @param var      The variable to encode.
- * @param enums    The enumeration ff this variable is enumerated. may be NULL.
- * @param hint     Contents of the DISPLAY-HINT clause of the MIB.
- *                 See RFC 1903 Section 3.1 for details. may be NULL.
- * @param units    Contents of the UNITS clause of the MIB. may be NULL.
+ * @param hint  Contents of the DISPLAY-HINT clause, must outlive the result.
  *
- * @return 1 on success, or 0 on failure (out of memory, or buffer to
- *         small when not allowed to realloc.)
+ * @return the compiled hint, to be released with free_display_hint(),
+ *         or NULL if hint is NULL or memory is exhausted.
  */
-int
-sprint_realloc_octet_string(u_char **buf, size_t *buf_len,
-                            size_t *out_len, int allow_realloc,
-                            const netsnmp_variable_list *var,
-                            const struct enum_list *enums, const char *hint,
-                            const char *units) {
-    size_t saved_out_len = *out_len;
-    const char *saved_hint = hint;
-    int hex = 0, x = 0;
-    u_char *cp;
-    int output_format, cnt;
+struct display_hint *
+compile_display_hint(const char *hint) {
+    struct display_hint *dh;
+    struct hint_spec *sp;
+    const char *cp = hint;
+    char ch;
+
+    if (!hint)
+        return NULL;
 
-    if (var->type != ASN_OCTET_STR) {
-        return sprint_realloc_by_type(buf, buf_len, out_len,
-                                      allow_realloc, var, NULL, NULL,
-                                      NULL);
+    /*
+     * every specification consumes at least one character of the clause
+     */
+    dh = (struct display_hint *) calloc(1, sizeof(struct display_hint) +
+                                        strlen(hint) * sizeof(struct hint_spec));
+    if (!dh)
+        return NULL;
+    dh->text = hint;
+    dh->specs = (struct hint_spec *) (dh + 1);
+
+    dh->int_code = hint[0];
+    if (hint[0] == 'd' && hint[1] == '-')
+        dh->int_shift = atoi(hint + 2);
+
+    while (*cp) {
+        sp = &dh->specs[dh->nspecs++];
+        if (*cp == '*') {
+            sp->star = 1;
+            cp++;
+        }
+        while ('0' <= *cp && *cp <= '9')
+            sp->width = (sp->width * 10) + (*cp++ - '0');
+        sp->code = *cp;
+        if (!*cp) {             /* no format code: reported when printed */
+            sp->width = 1;
+            break;
+        }
+        cp++;
+        if ((ch = *cp) && ch != '*' && (ch < '0' || ch > '9')
+            && (sp->width != 0 || (ch != 'x' && ch != 'd' && ch != 'o')))
+            sp->separ = *cp++;
+        if ((ch = *cp) && ch != '*' && (ch < '0' || ch > '9')
+            && (sp->width != 0 || (ch != 'x' && ch != 'd' && ch != 'o')))
+            sp->term = *cp++;
+        if (sp->width == 0)     /* Handle malformed hint strings */
+            sp->width = 1;
     }
 
+    /*
+     * Single hex digits are padded to two only while running the last
+     * specification, and only if it has no separator: for the data 0xAA01BB,
+     * would anyone really ever want the string "AA1BB"??
+     */
+    if (dh->nspecs) {
+        sp = &dh->specs[dh->nspecs - 1];
+        sp->pad = (sp->width == 1 && sp->separ == 0);
+    }
+
+    if (!strcmp(hint, "255a"))
+        dh->kind = DISPLAY_HINT_STRING;
+    else if (!strcmp(hint, "1x:"))
+        dh->kind = DISPLAY_HINT_HEX_OCTETS;
+    else if (!strcmp(hint, "2d-1d-1d,1d:1d:1d.1d,1a1d:1d"))
+        dh->kind = DISPLAY_HINT_DATEANDTIME;
+    else if (!strcmp(hint, "1d.1d.1d.1d"))
+        dh->kind = DISPLAY_HINT_IPV4;
+    else if (!strcmp(hint, "2x:2x:2x:2x:2x:2x:2x:2x"))
+        dh->kind = DISPLAY_HINT_IPV6;
+    else
+        dh->kind = DISPLAY_HINT_GENERIC;
+    return dh;
+}
+
+void
+free_display_hint(struct display_hint *hint) {
+    free(hint);
+}
 
-    if (hint) {
-        int repeat, width = 1;
-        long value;
-        char code = 'd', separ = 0, term = 0, ch, intbuf[32];
-#define HEX2DIGIT_NEED_INIT 3
-        char hex2digit = HEX2DIGIT_NEED_INIT;
-        u_char *ecp;
+static char *
+ulong_to_decimal(char *cp, u_long value) {
+    char digits[I64CHARSZ];
+    int n = 0;
 
-        if (!snmp_cstrcat(buf, buf_len, out_len, allow_realloc, "STRING: ")) {
+    do {
+        digits[n++] = '0' + value % 10;
+        value /= 10;
+    } while (value);
+    while (n)
+        *cp++ = digits[--n];
+    return cp;
+}
+
+/*
+ * Prints four subids as "a.b.c.d".
+ */
+static char *
+oid_to_dotted_quad(char *cp, const oid *objid) {
+    int i;
+
+    for (i = 0; i < 4; i++) {
+        if (i)
+            *cp++ = '.';
+        cp = ulong_to_decimal(cp, objid[i]);
+    }
+    return cp;
+}
+
+static char *
+ulong_to_hex(char *cp, u_long value) {
+    char digits[I64CHARSZ];
+    int n = 0;
+
+    do {
+        digits[n++] = "0123456789abcdef"[value & 0x0F];
+        value >>= 4;
+    } while (value);
+    while (n)
+        *cp++ = digits[--n];
+    return cp;
+}
+
+/*
+ * Dedicated formatters for the common hints.  Each one prints exactly what
+ * the generic loop prints for the same hint, but only for the value lengths
+ * the textual convention defines; anything else goes through the loop.
+ *
+ * @return 1 on success, 0 when out of memory, -1 if not applicable.
+ */
+static int
+sprint_realloc_hint_fast(u_char **buf, size_t *buf_len, size_t *out_len,
+                         int allow_realloc, const u_char *cp, size_t len,
+                         const struct display_hint *hint) {
+    size_t need, i;
+    char *op;
+
+    switch (hint->kind) {
+        case DISPLAY_HINT_STRING:
+            if (memchr(cp, '\0', len) != NULL)
+                return -1;
+            need = len;
+            break;
+        case DISPLAY_HINT_HEX_OCTETS:
+            need = 3 * len;
+            break;
+        case DISPLAY_HINT_DATEANDTIME:
+            if (len != 8 && len != 11)
+                return -1;
+            need = 48;
+            break;
+        case DISPLAY_HINT_IPV4:
+            if (len != 4)
+                return -1;
+            need = 16;
+            break;
+        case DISPLAY_HINT_IPV6:
+            if (len != 16)
+                return -1;
+            need = 40;
+            break;
+        default:
+            return -1;
+    }
+
+    while ((*out_len + need + 1) >= *buf_len) {
+        if (!(allow_realloc && snmp_realloc(buf, buf_len))) {
             return 0;
         }
+    }
+    op = (char *) *buf + *out_len;
+
+    switch (hint->kind) {
+        case DISPLAY_HINT_STRING:
+            /* No embedded '\0' - use memcpy() to preserve UTF-8 */
+            memcpy(op, cp, len);
+            op += len;
+            break;
+        case DISPLAY_HINT_HEX_OCTETS:
+            for (i = 0; i < len; i++) {
+                if (i)
+                    *op++ = ':';
+                op = ulong_to_hex(op, cp[i]);
+            }
+            break;
+        case DISPLAY_HINT_DATEANDTIME:
+            op = ulong_to_decimal(op, cp[0] * 256 + cp[1]);
+            *op++ = '-';
+            op = ulong_to_decimal(op, cp[2]);
+            *op++ = '-';
+            op = ulong_to_decimal(op, cp[3]);
+            *op++ = ',';
+            op = ulong_to_decimal(op, cp[4]);
+            *op++ = ':';
+            op = ulong_to_decimal(op, cp[5]);
+            *op++ = ':';
+            op = ulong_to_decimal(op, cp[6]);
+            *op++ = '.';
+            op = ulong_to_decimal(op, cp[7]);
+            if (len == 11) {
+                *op++ = ',';
+                *op++ = cp[8] ? cp[8] : '.';
+                op = ulong_to_decimal(op, cp[9]);
+                *op++ = ':';
+                op = ulong_to_decimal(op, cp[10]);
+            }
+            break;
+        case DISPLAY_HINT_IPV4:
+            for (i = 0; i < 4; i++) {
+                if (i)
+                    *op++ = '.';
+                op = ulong_to_decimal(op, cp[i]);
+            }
+            break;
+        case DISPLAY_HINT_IPV6:
+            for (i = 0; i < 16; i += 2) {
+                if (i)
+                    *op++ = ':';
+                op = ulong_to_hex(op, cp[i] * 256 + cp[i + 1]);
+            }
+            break;
+    }
 
-        cp = var->val.string;
-        ecp = cp + var->val_len;
+    *out_len = op - (char *) *buf;
+    *(*buf + *out_len) = '\0';
+    return 1;
+}
 
-        while (cp < ecp) {
-            repeat = 1;
-            if (*hint) {
-                if (*hint == '*') {
-                    repeat = *cp++;
-                    hint++;
+/*
+ * Prints the octets cp[0..len) as directed by a compiled DISPLAY-HINT
+ * (RFC 2579 section 3.1).  Once the specifications are used up the last
+ * one is applied to the remaining octets.
+ *
+ * @return 1 on success, 0 when out of memory, -1 when the hint holds a
+ *         format code RFC 2579 does not define.
+ */
+static int
+sprint_realloc_hint_program(u_char **buf, size_t *buf_len, size_t *out_len,
+                            int allow_realloc, const u_char *cp, size_t len,
+                            const struct display_hint *hint) {
+    static const struct hint_spec default_spec = {1, 'd', 0, 0, 0, 0};
+    const struct hint_spec *sp = &default_spec;
+    const u_char *ecp = cp + len;
+    int next = 0, repeat, x, cnt, rc;
+    long value;
+    char intbuf[32];
+
+    if (hint->kind != DISPLAY_HINT_GENERIC &&
+        (rc = sprint_realloc_hint_fast(buf, buf_len, out_len, allow_realloc,
+                                       cp, len, hint)) >= 0) {
+        return rc;
+    }
+
+    while (cp < ecp) {
+        repeat = 1;
+        if (next < hint->nspecs) {
+            sp = &hint->specs[next++];
+            if (sp->star)
+                repeat = *cp++;
+        }
+
+        while (repeat && cp < ecp) {
+            value = 0;
+            if (sp->code != 'a' && sp->code != 't') {
+                for (x = 0; x < sp->width; x++) {
+                    value = value * 256 + *cp++;
                 }
-                width = 0;
-                while ('0' <= *hint && *hint <= '9')
-                    width = (width * 10) + (*hint++ - '0');
-                code = *hint++;
-                if ((ch = *hint) && ch != '*' && (ch < '0' || ch > '9')
-                    && (width != 0
-                        || (ch != 'x' && ch != 'd' && ch != 'o')))
-                    separ = *hint++;
-                else
-                    separ = 0;
-                if ((ch = *hint) && ch != '*' && (ch < '0' || ch > '9')
-                    && (width != 0
-                        || (ch != 'x' && ch != 'd' && ch != 'o')))
-                    term = *hint++;
-                else
-                    term = 0;
-                if (width == 0)  /* Handle malformed hint strings */
-                    width = 1;
             }
-
-            while (repeat && cp < ecp) {
-                value = 0;
-                if (code != 'a' && code != 't') {
-                    for (x = 0; x < width; x++) {
-                        value = value * 256 + *cp++;
+            switch (sp->code) {
+                case 'x':
+                    if (value < 16 && sp->pad) {
+                        sprintf(intbuf, "0%lx", value);
+                    } else {
+                        sprintf(intbuf, "%lx", value);
                     }
-                }
-                switch (code) {
-                    case 'x':
-                        if (HEX2DIGIT_NEED_INIT == hex2digit)
-                            hex2digit = 0;
-                        /*
-                         * if value is < 16, it will be a single hex digit. If the
-                         * width is 1 (we are outputting a byte at a time), pat it
-                         * to 2 digits if NETSNMP_DS_LIB_2DIGIT_HEX_OUTPUT is set
-                         * or all of the following are true:
-                         *  - we do not have a separation character
-                         *  - there is no hint left (or there never was a hint)
-                         *
-                         * e.g. for the data 0xAA01BB, would anyone really ever
-                         * want the string "AA1BB"??
-                         */
-                        if (((value < 16) && (1 == width)) &&
-                            (hex2digit || ((0 == separ) && (0 == *hint)))) {
-                            sprintf(intbuf, "0%lx", value);
-                        } else {
-                            sprintf(intbuf, "%lx", value);
-                        }
-                        if (!snmp_cstrcat
-                        (buf, buf_len, out_len, allow_realloc, intbuf)) {
-                            return 0;
-                        }
-                        break;
-                    case 'd':
-                        sprintf(intbuf, "%ld", value);
-                        if (!snmp_cstrcat
-                        (buf, buf_len, out_len, allow_realloc, intbuf)) {
-                            return 0;
-                        }
-                        break;
-                    case 'o':
-                        sprintf(intbuf, "%lo", value);
-                        if (!snmp_cstrcat
-                        (buf, buf_len, out_len, allow_realloc, intbuf)) {
-                            return 0;
-                        }
-                        break;
-                    case 't': /* new in rfc 3411 */
-                    case 'a':
-                        /* A string hint gives the max size - we may not need this much */
-                        cnt = SNMP_MIN(width, ecp - cp);
-                        while ((*out_len + cnt + 1) > *buf_len) {
-                            if (!allow_realloc || !snmp_realloc(buf, buf_len))
-                                return 0;
-                        }
-                        if (memchr(cp, '\0', cnt) == NULL) {
-                            /* No embedded '\0' - use memcpy() to preserve UTF-8 */
-                            memcpy(*buf + *out_len, cp, cnt);
-                            *out_len += cnt;
-                            *(*buf + *out_len) = '\0';
-                        } else if (!sprint_realloc_asciistring(buf, buf_len,
-                                                               out_len, allow_realloc, cp, cnt)) {
-                            return 0;
-                        }
-                        cp += cnt;
-                        break;
-                    default:
-                        *out_len = saved_out_len;
-                        if (snmp_cstrcat(buf, buf_len, out_len, allow_realloc,
-                                         "(Bad hint ignored: ")
-                            && snmp_cstrcat(buf, buf_len, out_len,
-                                            allow_realloc, saved_hint)
-                            && snmp_cstrcat(buf, buf_len, out_len,
-                                            allow_realloc, ") ")) {
-                            return sprint_realloc_octet_string(buf, buf_len,
-                                                               out_len,
-                                                               allow_realloc,
-                                                               var, enums,
-                                                               NULL, NULL);
-                        } else {
-                            return 0;
-                        }
-                }
-
-                if (cp < ecp && separ) {
-                    while ((*out_len + 1) >= *buf_len) {
-                        if (!(allow_realloc && snmp_realloc(buf, buf_len))) {
+                    if (!snmp_cstrcat
+                    (buf, buf_len, out_len, allow_realloc, intbuf)) {
+                        return 0;
+                    }
+                    break;
+                case 'd':
+                    sprintf(intbuf, "%ld", value);
+                    if (!snmp_cstrcat
+                    (buf, buf_len, out_len, allow_realloc, intbuf)) {
+                        return 0;
+                    }
+                    break;
+                case 'o':
+                    sprintf(intbuf, "%lo", value);
+                    if (!snmp_cstrcat
+                    (buf, buf_len, out_len, allow_realloc, intbuf)) {
+                        return 0;
+                    }
+                    break;
+                case 't': /* new in rfc 3411 */
+                case 'a':
+                    /* A string hint gives the max size - we may not need this much */
+                    cnt = SNMP_MIN(sp->width, ecp - cp);
+                    while ((*out_len + cnt + 1) > *buf_len) {
+                        if (!allow_realloc || !snmp_realloc(buf, buf_len))
                             return 0;
-                        }
                     }
-                    *(*buf + *out_len) = separ;
-                    (*out_len)++;
-                    *(*buf + *out_len) = '\0';
-                }
-                repeat--;
+                    if (memchr(cp, '\0', cnt) == NULL) {
+                        /* No embedded '\0' - use memcpy() to preserve UTF-8 */
+                        memcpy(*buf + *out_len, cp, cnt);
+                        *out_len += cnt;
+                        *(*buf + *out_len) = '\0';
+                    } else if (!sprint_realloc_asciistring(buf, buf_len,
+                                                           out_len, allow_realloc, cp, cnt)) {
+                        return 0;
+                    }
+                    cp += cnt;
+                    break;
+                default:
+                    return -1;
             }
 
-            if (term && cp < ecp) {
+            if (cp < ecp && sp->separ) {
                 while ((*out_len + 1) >= *buf_len) {
                     if (!(allow_realloc && snmp_realloc(buf, buf_len))) {
                         return 0;
                     }
                 }
-                *(*buf + *out_len) = term;
+                *(*buf + *out_len) = sp->separ;
                 (*out_len)++;
                 *(*buf + *out_len) = '\0';
             }
+            repeat--;
+        }
+
+        if (sp->term && cp < ecp) {
+            while ((*out_len + 1) >= *buf_len) {
+                if (!(allow_realloc && snmp_realloc(buf, buf_len))) {
+                    return 0;
+                }
+            }
+            *(*buf + *out_len) = sp->term;
+            (*out_len)++;
+            *(*buf + *out_len) = '\0';
+        }
+    }
+    return 1;
+}
+
+/*
+ * sprint_realloc_octet_string() for an already compiled hint; var must be
+ * of type ASN_OCTET_STR.
+ */
+static int
+sprint_realloc_octet_string_hinted(u_char **buf, size_t *buf_len,
+                                   size_t *out_len, int allow_realloc,
+                                   const netsnmp_variable_list *var,
+                                   const struct enum_list *enums,
+                                   const struct display_hint *hint,
+                                   const char *units) {
+    size_t saved_out_len = *out_len;
+    int hex = 0;
+
+    if (hint) {
+        int rc;
+
+        if (!snmp_cstrcat(buf, buf_len, out_len, allow_realloc, "STRING: ")) {
+            return 0;
+        }
+
+        rc = sprint_realloc_hint_program(buf, buf_len, out_len, allow_realloc,
+                                         var->val.string, var->val_len, hint);
+        if (rc < 0) {
+            *out_len = saved_out_len;
+            if (snmp_cstrcat(buf, buf_len, out_len, allow_realloc,
+                             "(Bad hint ignored: ")
+                && snmp_cstrcat(buf, buf_len, out_len,
+                                allow_realloc, hint->text)
+                && snmp_cstrcat(buf, buf_len, out_len,
+                                allow_realloc, ") ")) {
+                return sprint_realloc_octet_string_hinted(buf, buf_len,
+                                                          out_len,
+                                                          allow_realloc,
+                                                          var, enums,
+                                                          NULL, NULL);
+            } else {
+                return 0;
+            }
+        }
+        if (!rc) {
+            return 0;
         }
 
         if (units) {
@@ -794,12 +1024,7 @@ sprint_realloc_octet_string(u_char **buf, size_t *buf_len,
         return 1;
     }
 
-    hex = 0;
-    for (cp = var->val.string, x = 0; x < (int) var->val_len; x++, cp++) {
-        if (!isprint(*cp) && !isspace(*cp)) {
-            hex = 1;
-        }
-    }
+    hex = !octet_string_is_printable(var->val.string, var->val_len);
 
     if (var->val_len == 0) {
         return snmp_cstrcat(buf, buf_len, out_len, allow_realloc, "\"\"");
@@ -842,6 +1067,57 @@ sprint_realloc_octet_string(u_char **buf, size_t *buf_len,
     return 1;
 }
 
+/**
+ * Prints an octet string into a buffer.
+ *
+ * The variable var is encoded as octet string.
+ *
+ * If allow_realloc is true the buffer will be (re)allocated to fit in the
+ * needed size. (Note: *buf may change due to this.)
+ *
+ * @param buf      Address of the buffer to print to.
+ * @param buf_len  Address to an integer containing the size of buf.
+ * @param out_len  Incremented by the number of characters printed.
+ * @param allow_realloc if not zero reallocate the buffer to fit the
+ *                      needed size.
+ * @param var      The variable to encode.
+ * @param enums    The enumeration ff this variable is enumerated. may be NULL.
+ * @param hint     Contents of the DISPLAY-HINT clause of the MIB.
+ *                 See RFC 1903 Section 3.1 for details. may be NULL.
+ * @param units    Contents of the UNITS clause of the MIB. may be NULL.
+ *
+ * @return 1 on success, or 0 on failure (out of memory, or buffer to
+ *         small when not allowed to realloc.)
+ */
+int
+sprint_realloc_octet_string(u_char **buf, size_t *buf_len,
+                            size_t *out_len, int allow_realloc,
+                            const netsnmp_variable_list *var,
+                            const struct enum_list *enums, const char *hint,
+                            const char *units) {
+    struct display_hint *dh;
+    int rc;
+
+    if (var->type != ASN_OCTET_STR) {
+        return sprint_realloc_by_type(buf, buf_len, out_len,
+                                      allow_realloc, var, NULL, NULL,
+                                      NULL);
+    }
+    if (!hint) {
+        return sprint_realloc_octet_string_hinted(buf, buf_len, out_len,
+                                                  allow_realloc, var, enums,
+                                                  NULL, units);
+    }
+    if (!(dh = compile_display_hint(hint))) {
+        return 0;
+    }
+    rc = sprint_realloc_octet_string_hinted(buf, buf_len, out_len,
+                                            allow_realloc, var, enums, dh,
+                                            units);
+    free_display_hint(dh);
+    return rc;
+}
+
 
 /**
  * Prints a bit string into a buffer.
@@ -930,40 +1206,19 @@ sprint_realloc_bitstring(u_char **buf, size_t *buf_len, size_t *out_len,
 }
 
 
-/**
- * Prints an unsigned integer into a buffer.
- *
- * If allow_realloc is true the buffer will be (re)allocated to fit in the
- * needed size. (Note: *buf may change due to this.)
- *
- * @param buf      Address of the buffer to print to.
- * @param buf_len  Address to an integer containing the size of buf.
- * @param out_len  Incremented by the number of characters printed.
- * @param allow_realloc if not zero reallocate the buffer to fit the
- *                      needed size.
- * @param var      The variable to encode.
- * @param enums    The enumeration ff this variable is enumerated. may be NULL.
- * @param hint     Contents of the DISPLAY-HINT clause of the MIB.
- *                 See RFC 1903 Section 3.1 for details. may be NULL.
- * @param units    Contents of the UNITS clause of the MIB. may be NULL.
- *
- * @return 1 on success, or 0 on failure (out of memory, or buffer to
- *         small when not allowed to realloc.)
+/*
+ * sprint_realloc_uinteger() for an already compiled hint; var must be
+ * of type ASN_UINTEGER.
  */
-int
-sprint_realloc_uinteger(u_char **buf, size_t *buf_len, size_t *out_len,
-                        int allow_realloc,
-                        const netsnmp_variable_list *var,
-                        const struct enum_list *enums,
-                        const char *hint, const char *units) {
+static int
+sprint_realloc_uinteger_hinted(u_char **buf, size_t *buf_len, size_t *out_len,
+                               int allow_realloc,
+                               const netsnmp_variable_list *var,
+                               const struct enum_list *enums,
+                               const struct display_hint *hint,
+                               const char *units) {
     char *enum_string = NULL;
 
-    if (var->type != ASN_UINTEGER) {
-        return sprint_realloc_by_type(buf, buf_len, out_len,
-                                      allow_realloc, var, NULL, NULL,
-                                      NULL);
-    }
-
     for (; enums; enums = enums->next) {
         if (enums->value == *var->val.integer) {
             enum_string = enums->label;
@@ -973,10 +1228,10 @@ sprint_realloc_uinteger(u_char **buf, size_t *buf_len, size_t *out_len,
 
     if (enum_string == NULL) {
         if (hint) {
-            if (!(sprint_realloc_hinted_integer(buf, buf_len, out_len,
-                                                allow_realloc,
-                                                *var->val.integer, 'u',
-                                                hint, units))) {
+            if (!(sprint_realloc_integer_program(buf, buf_len, out_len,
+                                                 allow_realloc,
+                                                 *var->val.integer, 'u',
+                                                 hint))) {
                 return 0;
             }
         } else {
@@ -1012,9 +1267,8 @@ sprint_realloc_uinteger(u_char **buf, size_t *buf_len, size_t *out_len,
     return 1;
 }
 
-
 /**
- * Prints a gauge value into a buffer.
+ * Prints an unsigned integer into a buffer.
  *
  * If allow_realloc is true the buffer will be (re)allocated to fit in the
  * needed size. (Note: *buf may change due to this.)
@@ -1034,28 +1288,48 @@ sprint_realloc_uinteger(u_char **buf, size_t *buf_len, size_t *out_len,
  *         small when not allowed to realloc.)
  */
 int
-sprint_realloc_gauge(u_char **buf, size_t *buf_len, size_t *out_len,
-                     int allow_realloc,
-                     const netsnmp_variable_list *var,
-                     const struct enum_list *enums,
-                     const char *hint, const char *units) {
-    char tmp[32];
+sprint_realloc_uinteger(u_char **buf, size_t *buf_len, size_t *out_len,
+                        int allow_realloc,
+                        const netsnmp_variable_list *var,
+                        const struct enum_list *enums,
+                        const char *hint, const char *units) {
+    struct display_hint dh;
 
-    if (var->type != ASN_GAUGE) {
+    if (var->type != ASN_UINTEGER) {
         return sprint_realloc_by_type(buf, buf_len, out_len,
                                       allow_realloc, var, NULL, NULL,
                                       NULL);
     }
 
+    return sprint_realloc_uinteger_hinted(buf, buf_len, out_len, allow_realloc,
+                                          var, enums,
+                                          integer_display_hint(&dh, hint),
+                                          units);
+}
+
+
+/*
+ * sprint_realloc_gauge() for an already compiled hint; var must be
+ * of type ASN_GAUGE.
+ */
+static int
+sprint_realloc_gauge_hinted(u_char **buf, size_t *buf_len, size_t *out_len,
+                            int allow_realloc,
+                            const netsnmp_variable_list *var,
+                            const struct enum_list *enums,
+                            const struct display_hint *hint,
+                            const char *units) {
+    char tmp[32];
+
     u_char str[] = "Gauge32: ";
     if (!snmp_strcat(buf, buf_len, out_len, allow_realloc, str)) {
         return 0;
     }
     if (hint) {
-        if (!sprint_realloc_hinted_integer(buf, buf_len, out_len,
-                                           allow_realloc,
-                                           *var->val.integer, 'u', hint,
-                                           units)) {
+        if (!sprint_realloc_integer_program(buf, buf_len, out_len,
+                                            allow_realloc,
+                                            *var->val.integer, 'u',
+                                            hint)) {
             return 0;
         }
     } else {
@@ -1075,6 +1349,46 @@ sprint_realloc_gauge(u_char **buf, size_t *buf_len, size_t *out_len,
     return 1;
 }
 
+/**
+ * Prints a gauge value into a buffer.
+ *
+ * If allow_realloc is true the buffer will be (re)allocated to fit in the
+ * needed size. (Note: *buf may change due to this.)
+ *
+ * @param buf      Address of the buffer to print to.
+ * @param buf_len  Address to an integer containing the size of buf.
+ * @param out_len  Incremented by the number of characters printed.
+ * @param allow_realloc if not zero reallocate the buffer to fit the
+ *                      needed size.
+ * @param var      The variable to encode.
+ * @param enums    The enumeration ff this variable is enumerated. may be NULL.
+ * @param hint     Contents of the DISPLAY-HINT clause of the MIB.
+ *                 See RFC 1903 Section 3.1 for details. may be NULL.
+ * @param units    Contents of the UNITS clause of the MIB. may be NULL.
+ *
+ * @return 1 on success, or 0 on failure (out of memory, or buffer to
+ *         small when not allowed to realloc.)
+ */
+int
+sprint_realloc_gauge(u_char **buf, size_t *buf_len, size_t *out_len,
+                     int allow_realloc,
+                     const netsnmp_variable_list *var,
+                     const struct enum_list *enums,
+                     const char *hint, const char *units) {
+    struct display_hint dh;
+
+    if (var->type != ASN_GAUGE) {
+        return sprint_realloc_by_type(buf, buf_len, out_len,
+                                      allow_realloc, var, NULL, NULL,
+                                      NULL);
+    }
+
+    return sprint_realloc_gauge_hinted(buf, buf_len, out_len, allow_realloc,
+                                       var, enums,
+                                       integer_display_hint(&dh, hint),
+                                       units);
+}
+
 
 /**
  * Prints a counter value into a buffer.
@@ -1518,6 +1832,211 @@ sprint_realloc_by_type(u_char **buf, size_t *buf_len, size_t *out_len,
     }
 }
 
+/**
+ * Prints a variable into a buffer as directed by a compiled DISPLAY-HINT.
+ *
+ * Same as sprint_realloc_by_type(), except that the hint has already been
+ * parsed, typically when the MIB was loaded.  Only INTEGER, Unsigned32,
+ * Gauge32 and OCTET STRING values make use of a hint.
+ *
+ * @param hint     The compiled DISPLAY-HINT clause of the MIB. may be NULL.
+ *
+ * @return 1 on success, or 0 on failure (out of memory, or buffer to
+ *         small when not allowed to realloc.)
+ */
+int
+sprint_realloc_by_type_hinted(u_char **buf, size_t *buf_len, size_t *out_len,
+                              int allow_realloc,
+                              const netsnmp_variable_list *var,
+                              const struct enum_list *enums,
+                              const struct display_hint *hint,
+                              const char *units) {
+    switch (var->type) {
+        case ASN_INTEGER:
+            return sprint_realloc_integer_hinted(buf, buf_len, out_len,
+                                                 allow_realloc, var, enums,
+                                                 hint, units);
+        case ASN_OCTET_STR:
+            return sprint_realloc_octet_string_hinted(buf, buf_len, out_len,
+                                                      allow_realloc, var,
+                                                      enums, hint, units);
+        case ASN_GAUGE:
+            return sprint_realloc_gauge_hinted(buf, buf_len, out_len,
+                                               allow_realloc, var, enums,
+                                               hint, units);
+        case ASN_UINTEGER:
+            return sprint_realloc_uinteger_hinted(buf, buf_len, out_len,
+                                                  allow_realloc, var, enums,
+                                                  hint, units);
+        default:
+            return sprint_realloc_by_type(buf, buf_len, out_len, allow_realloc,
+                                          var, enums,
+                                          hint ? hint->text : NULL, units);
+    }
+}
+
+/*
+ * Value printers bound to MIB nodes by netsnmp_bind_printomats(), one per
+ * ASN.1 type the node is declared with.  A value of that type goes straight
+ * to the type's printer with the node's enums, compiled hint and units; a
+ * value of any other type (an agent not following its MIB) is printed by
+ * sprint_realloc_by_type() as if no printer were bound.
+ */
+template <u_char Type, bool Hinted>
+static int
+sprint_realloc_node_value(u_char **buf, size_t *buf_len, size_t *out_len,
+                          int allow_realloc,
+                          const netsnmp_variable_list *var,
+                          const struct tree *tp) {
+    const struct display_hint *hint = Hinted ? tp->hint_program : NULL;
+    const char *units = Hinted ? tp->units : NULL;
+
+    if (var->type != Type) {
+        return sprint_realloc_by_type(buf, buf_len, out_len, allow_realloc,
+                                      var, tp->enums, NULL, NULL);
+    }
+    if constexpr (Type == ASN_INTEGER) {
+        return sprint_realloc_integer_hinted(buf, buf_len, out_len,
+                                             allow_realloc, var, tp->enums,
+                                             hint, units);
+    } else if constexpr (Type == ASN_OCTET_STR) {
+        return sprint_realloc_octet_string_hinted(buf, buf_len, out_len,
+                                                  allow_realloc, var,
+                                                  tp->enums, hint, units);
+    } else if constexpr (Type == ASN_GAUGE) {
+        return sprint_realloc_gauge_hinted(buf, buf_len, out_len,
+                                           allow_realloc, var, tp->enums,
+                                           hint, units);
+    } else if constexpr (Type == ASN_UINTEGER) {
+        return sprint_realloc_uinteger_hinted(buf, buf_len, out_len,
+                                              allow_realloc, var, tp->enums,
+                                              hint, units);
+    } else if constexpr (Type == ASN_OBJECT_ID) {
+        return sprint_realloc_object_identifier(buf, buf_len, out_len,
+                                                allow_realloc, var, tp->enums,
+                                                NULL, units);
+    } else if constexpr (Type == ASN_TIMETICKS) {
+        return sprint_realloc_timeticks(buf, buf_len, out_len, allow_realloc,
+                                        var, tp->enums, NULL, units);
+    } else if constexpr (Type == ASN_COUNTER) {
+        return sprint_realloc_counter(buf, buf_len, out_len, allow_realloc,
+                                      var, tp->enums, NULL, units);
+    } else if constexpr (Type == ASN_IPADDRESS) {
+        return sprint_realloc_ipaddress(buf, buf_len, out_len, allow_realloc,
+                                        var, tp->enums, NULL, units);
+    } else {
+        static_assert(Type == ASN_COUNTER64, "no printer for this type");
+        return sprint_realloc_counter64(buf, buf_len, out_len, allow_realloc,
+                                        var, tp->enums, NULL, units);
+    }
+}
+
+template <u_char Type>
+static node_printer
+node_printer_for(int hinted) {
+    return hinted ? sprint_realloc_node_value<Type, true>
+                  : sprint_realloc_node_value<Type, false>;
+}
+
+/*
+ * Selects the value printer for one node from its MIB syntax.  BITS values
+ * travel as OCTET STRING and Unsigned32 as Gauge32, so those are the types
+ * their printers expect.  Nodes without a value (and Opaque, NsapAddress)
+ * keep no printer and go through sprint_realloc_by_type().
+ */
+static node_printer
+select_node_printer(const struct tree *tp) {
+    int hinted = display_hints && (tp->hint_program || tp->units);
+
+    switch (tp->type) {
+        case TYPE_INTEGER:
+        case TYPE_INTEGER32:
+            return node_printer_for<ASN_INTEGER>(hinted);
+        case TYPE_OCTETSTR:
+        case TYPE_BITSTRING:
+            return node_printer_for<ASN_OCTET_STR>(hinted);
+        case TYPE_GAUGE:
+        case TYPE_UNSIGNED32:
+            return node_printer_for<ASN_GAUGE>(hinted);
+        case TYPE_UINTEGER:
+            return node_printer_for<ASN_UINTEGER>(hinted);
+        case TYPE_OBJID:
+            return node_printer_for<ASN_OBJECT_ID>(hinted);
+        case TYPE_TIMETICKS:
+            return node_printer_for<ASN_TIMETICKS>(hinted);
+        case TYPE_COUNTER:
+            return node_printer_for<ASN_COUNTER>(hinted);
+        case TYPE_NETADDR:
+        case TYPE_IPADDR:
+            return node_printer_for<ASN_IPADDRESS>(hinted);
+        case TYPE_COUNTER64:
+            return node_printer_for<ASN_COUNTER64>(hinted);
+        default:
+            return NULL;
+    }
+}
+
+/**
+ * Binds a value printer (struct tree printomat) to every node of the MIB
+ * tree, so that sprint_realloc_variable() needs one indirect call per
+ * variable instead of dispatching on its type.
+ *
+ * Called after the MIBs are loaded and whenever the display hint setting
+ * changes.
+ */
+void
+netsnmp_bind_printomats(struct tree *tp) {
+    for (; tp; tp = tp->next_peer) {
+        tp->printomat = select_node_printer(tp);
+        netsnmp_bind_printomats(tp->child_list);
+    }
+}
+
+/**
+ * Finds the MIB node an OID falls under by walking the tree one subid at a
+ * time, without rendering anything.
+ *
+ * @param objid    The OID to look up.
+ * @param objidlen Number of subids in objid.
+ * @param subtree  Where to start, normally get_tree_head().
+ *
+ * @return the deepest node matching a prefix of objid, or NULL if not even
+ *         the first subid matches.
+ */
+struct tree *
+get_tree(const oid *objid, size_t objidlen, struct tree *subtree) {
+    struct tree *return_tree = NULL;
+
+    if (!objidlen)
+        return NULL;
+
+    for (; subtree; subtree = subtree->next_peer) {
+        if (*objid == subtree->subid)
+            goto found;
+    }
+
+    return NULL;
+
+    found:
+    while (subtree->next_peer && subtree->next_peer->subid == *objid)
+        subtree = subtree->next_peer;
+    if (objidlen > 1)
+        return_tree =
+                get_tree(objid + 1, objidlen - 1, subtree->child_list);
+    if (return_tree != NULL)
+        return return_tree;
+    else
+        return subtree;
+}
+
+/**
+ * Returns the root of the loaded MIB tree, NULL before init_mib().
+ */
+struct tree *
+get_tree_head(void) {
+    return tree_head;
+}
+
 struct tree *
 find_tree_node(const char *name, int modid) {
     struct tree *tp, *headtp;
@@ -1558,10 +2077,10 @@ _get_realloc_symbol_octet_string(size_t numids, const oid *objid,
     var.val.string = buffer;
     var.val_len = numids;
     if (!*buf_overflow) {
-        if (!sprint_realloc_octet_string(buf, buf_len, out_len,
-                                         allow_realloc, &var,
-                                         NULL, tp->hint,
-                                         NULL)) {
+        if (!sprint_realloc_octet_string_hinted(buf, buf_len, out_len,
+                                                allow_realloc, &var,
+                                                NULL, tp->hint_program,
+                                                NULL)) {
             *buf_overflow = 1;
         }
     }
@@ -1574,45 +2093,29 @@ dump_realloc_oid_to_string(const oid *objid, size_t objidlen,
                            size_t *out_len, int allow_realloc,
                            char quotechar) {
     if (buf) {
-        int i, alen;
-
-        for (i = 0, alen = 0; i < (int) objidlen; i++) {
-            oid tst = objid[i];
-            if ((tst > 254) || (!isprint(tst))) {
-                tst = (oid) '.';
-            }
-
-            if (alen == 0) {
-                while ((*out_len + 2) >= *buf_len) {
-                    if (!(allow_realloc && snmp_realloc(buf, buf_len))) {
-                        return 0;
-                    }
-                }
-                *(*buf + *out_len) = quotechar;
-                (*out_len)++;
-            }
+        u_char *cp;
+        size_t i;
 
-            while ((*out_len + 2) >= *buf_len) {
-                if (!(allow_realloc && snmp_realloc(buf, buf_len))) {
-                    return 0;
-                }
+        /*
+         * Room for the quotes, every subid and the terminator at once.
+         */
+        while ((*out_len + objidlen + 3) >= *buf_len) {
+            if (!(allow_realloc && snmp_realloc(buf, buf_len))) {
+                return 0;
             }
-            *(*buf + *out_len) = (char) tst;
-            (*out_len)++;
-            alen++;
         }
 
-        if (alen) {
-            while ((*out_len + 2) >= *buf_len) {
-                if (!(allow_realloc && snmp_realloc(buf, buf_len))) {
-                    return 0;
-                }
+        cp = *buf + *out_len;
+        if (objidlen) {
+            *cp++ = quotechar;
+            for (i = 0; i < objidlen; i++) {
+                oid tst = objid[i];
+                *cp++ = (tst > 254 || !isprint(tst)) ? '.' : (u_char) tst;
             }
-            *(*buf + *out_len) = quotechar;
-            (*out_len)++;
+            *cp++ = quotechar;
         }
-
-        *(*buf + *out_len) = '\0';
+        *cp = '\0';
+        *out_len = cp - *buf;
     }
 
     return 1;
@@ -1642,9 +2145,8 @@ dump_realloc_oid_to_inetaddress(const int addr_type, const oid *objid, size_t ob
                                 u_char **buf, size_t *buf_len,
                                 size_t *out_len, int allow_realloc,
                                 char quotechar) {
-    int i, len;
+    int i;
     char intbuf[64], *p;
-    char *const end = intbuf + sizeof(intbuf);
     unsigned char *zc;
     unsigned long zone;
 
@@ -1665,12 +2167,7 @@ dump_realloc_oid_to_inetaddress(const int addr_type, const oid *objid, size_t ob
                 (addr_type == IPV4Z && objidlen != 8))
                 return 2;
 
-            len = snprintf(p, end - p, "%" NETSNMP_PRIo "u.%" NETSNMP_PRIo "u."
-                                       "%" NETSNMP_PRIo "u.%" NETSNMP_PRIo "u",
-                           objid[0], objid[1], objid[2], objid[3]);
-            p += len;
-            if (p >= end)
-                return 2;
+            p = oid_to_dotted_quad(p, objid);
             if (addr_type == IPV4Z) {
                 zc = (unsigned char *) &zone;
                 zc[0] = objid[4];
@@ -1678,10 +2175,8 @@ dump_realloc_oid_to_inetaddress(const int addr_type, const oid *objid, size_t ob
                 zc[2] = objid[6];
                 zc[3] = objid[7];
                 zone = ntohl(zone);
-                len = snprintf(p, end - p, "%%%lu", zone);
-                p += len;
-                if (p >= end)
-                    return 2;
+                *p++ = '%';
+                p = ulong_to_decimal(p, zone);
             }
 
             break;
@@ -1692,13 +2187,11 @@ dump_realloc_oid_to_inetaddress(const int addr_type, const oid *objid, size_t ob
                 (addr_type == IPV6Z && objidlen != 20))
                 return 2;
 
-            len = 0;
             for (i = 0; i < 16; i++) {
-                len = snprintf(p, end - p, "%s%02" NETSNMP_PRIo "x", i ? ":" : "",
-                               objid[i]);
-                p += len;
-                if (p >= end)
-                    return 2;
+                if (i)
+                    *p++ = ':';
+                *p++ = "0123456789abcdef"[objid[i] >> 4];
+                *p++ = "0123456789abcdef"[objid[i] & 0x0F];
             }
 
             if (addr_type == IPV6Z) {
@@ -1708,10 +2201,8 @@ dump_realloc_oid_to_inetaddress(const int addr_type, const oid *objid, size_t ob
                 zc[2] = objid[18];
                 zc[3] = objid[19];
                 zone = ntohl(zone);
-                len = snprintf(p, end - p, "%%%lu", zone);
-                p += len;
-                if (p >= end)
-                    return 2;
+                *p++ = '%';
+                p = ulong_to_decimal(p, zone);
             }
 
             break;
@@ -1723,12 +2214,7 @@ dump_realloc_oid_to_inetaddress(const int addr_type, const oid *objid, size_t ob
     }
 
     *p++ = quotechar;
-    if (p >= end)
-        return 2;
-
-    *p++ = '\0';
-    if (p >= end)
-        return 2;
+    *p = '\0';
 
     return snmp_cstrcat(buf, buf_len, out_len, allow_realloc, intbuf);
 }
@@ -1770,6 +2256,73 @@ uptimeString(u_long timeticks, char *buf, size_t buflen) {
     return buf;
 }
 
+static void
+free_index_decoder(struct index_decoder *decoder) {
+    if (!decoder)
+        return;
+    free(decoder->steps);
+    free(decoder);
+}
+
+static struct index_decoder *
+build_index_decoder(const struct index_list *indexes) {
+    struct index_decoder *decoder;
+    const struct index_list *ip;
+    int n = 0;
+
+    for (ip = indexes; ip; ip = ip->next)
+        n++;
+    if (!(decoder = (struct index_decoder *) calloc(1, sizeof(*decoder))))
+        return NULL;
+    if (n && !(decoder->steps =
+                       (struct index_step *) calloc(n, sizeof(struct index_step)))) {
+        free(decoder);
+        return NULL;
+    }
+    for (ip = indexes; ip; ip = ip->next) {
+        struct index_step *step = &decoder->steps[decoder->nsteps++];
+        struct tree *tp = find_tree_node(ip->ilabel, -1);
+
+        step->tp = tp;
+        step->implied = ip->isimplied;
+        step->fixed_len = -1;
+        if (!tp)
+            break;              /* decoding stops here */
+        if (tp->ranges && !tp->ranges->next
+            && tp->ranges->low == tp->ranges->high)
+            step->fixed_len = tp->ranges->low;
+        step->inet_address = tp->next_peer &&
+                             tp->tc_index != -1 &&
+                             tp->next_peer->tc_index != -1 &&
+                             strcmp(get_tc_descriptor(tp->tc_index),
+                                    "InetAddress") == 0 &&
+                             strcmp(get_tc_descriptor(tp->next_peer->tc_index),
+                                    "InetAddressType") == 0;
+    }
+    return decoder;
+}
+
+/**
+ * Looks up the index objects of every table entry in the tree once, for
+ * decoding the instance part of column OIDs.  Called after the MIBs are
+ * loaded.
+ */
+void
+netsnmp_bind_index_decoders(struct tree *tp) {
+    for (; tp; tp = tp->next_peer) {
+        free_index_decoder(tp->index_decoder);
+        tp->index_decoder = NULL;
+        if (tp->indexes) {
+            tp->index_decoder = build_index_decoder(tp->indexes);
+        } else if (tp->augments) {
+            struct tree *tp2 = find_tree_node(tp->augments, -1);
+            if (tp2)
+                tp->index_decoder = build_index_decoder(tp2->indexes);
+        }
+        netsnmp_bind_index_decoders(tp->child_list);
+    }
+}
+
 void
 _oid_finish_printing(const oid *objid, size_t objidlen,
                      u_char **buf, size_t *buf_len, size_t *out_len,
@@ -1803,9 +2356,11 @@ _get_realloc_symbol(const oid *objid, size_t objidlen,
                     struct tree *subtree,
                     u_char **buf, size_t *buf_len, size_t *out_len,
                     int allow_realloc, int *buf_overflow,
-                    struct index_list *in_dices, size_t *end_of_known) {
+                    const struct index_decoder *decoder,
+                    size_t *end_of_known) {
     struct tree *return_tree = NULL;
-    int output_format = 0;
+    const struct index_step *step;
+    int output_format = oid_output_format;
     char intbuf[64];
     struct tree *orgtree = subtree;
 
@@ -1818,14 +2373,9 @@ _get_realloc_symbol(const oid *objid, size_t objidlen,
         if (*objid == subtree->subid) {
             while (subtree->next_peer && subtree->next_peer->subid == *objid)
                 subtree = subtree->next_peer;
-            if (subtree->indexes) {
-                in_dices = subtree->indexes;
-            } else if (subtree->augments) {
-                struct tree *tp2 =
-                        find_tree_node(subtree->augments, -1);
-                if (tp2) {
-                    in_dices = tp2->indexes;
-                }
+            if (subtree->index_decoder) {
+                decoder = subtree->index_decoder->nsteps ?
+                          subtree->index_decoder : NULL;
             }
 
             if (!strncmp(subtree->label, ANON, ANON_LEN) ||
@@ -1857,13 +2407,14 @@ _get_realloc_symbol(const oid *objid, size_t objidlen,
                                                   subtree->child_list,
                                                   buf, buf_len, out_len,
                                                   allow_realloc,
-                                                  buf_overflow, in_dices,
+                                                  buf_overflow, decoder,
                                                   end_of_known);
             }
 
             if (return_tree != NULL) {
                 return return_tree;
             } else {
+                SNMP_PROBE2(symbol_hit, objidlen - 1, counter);
                 return subtree;
             }
         }
@@ -1876,8 +2427,10 @@ _get_realloc_symbol(const oid *objid, size_t objidlen,
      * Subtree not found.
      */
 
-    if (orgtree && in_dices && objidlen > 0) {
-        sprintf(intbuf, "%" NETSNMP_PRIo "u.", *objid);
+    if (orgtree && decoder && objidlen > 0) {
+        char *cp = ulong_to_decimal(intbuf, *objid);
+        *cp++ = '.';
+        *cp = '\0';
         if (!*buf_overflow
             && !snmp_strcat(buf, buf_len, out_len,
                             allow_realloc,
@@ -1888,11 +2441,11 @@ _get_realloc_symbol(const oid *objid, size_t objidlen,
         objidlen--;
     }
 
-    while (in_dices && (objidlen > 0)) {
+    step = decoder ? decoder->steps : NULL;
+    while (step && step < decoder->steps + decoder->nsteps
+           && (objidlen > 0)) {
         size_t numids;
-        struct tree *tp;
-
-        tp = find_tree_node(in_dices->ilabel, -1);
+        struct tree *tp = step->tp;
 
         if (!tp) {
             /*
@@ -1903,7 +2456,7 @@ _get_realloc_symbol(const oid *objid, size_t objidlen,
 
         switch (tp->type) {
             case TYPE_OCTETSTR:
-                if (in_dices->isimplied) {
+                if (step->implied) {
                     numids = objidlen;
                     if (numids > objidlen)
                         goto finish_it;
@@ -1915,12 +2468,11 @@ _get_realloc_symbol(const oid *objid, size_t objidlen,
                             *buf_overflow = 1;
                         }
                     }
-                } else if (tp->ranges && !tp->ranges->next
-                           && tp->ranges->low == tp->ranges->high) {
+                } else if (step->fixed_len >= 0) {
                     /*
                      * a fixed-length octet string
                      */
-                    numids = tp->ranges->low;
+                    numids = step->fixed_len;
                     if (numids > objidlen)
                         goto finish_it;
 
@@ -1952,22 +2504,12 @@ _get_realloc_symbol(const oid *objid, size_t objidlen,
                         }
                     } else {
                         if (!*buf_overflow) {
-                            struct tree *next_peer;
                             int normal_handling = 1;
 
-                            if (tp->next_peer) {
-                                next_peer = tp->next_peer;
-                            }
-
                             /* Try handling the InetAddress in the OID, in case of failure,
                              * use the normal_handling.
                              */
-                            if (tp->next_peer &&
-                                tp->tc_index != -1 &&
-                                next_peer->tc_index != -1 &&
-                                strcmp(get_tc_descriptor(tp->tc_index), "InetAddress") == 0 &&
-                                strcmp(get_tc_descriptor(next_peer->tc_index),
-                                       "InetAddressType") == 0) {
+                            if (step->inet_address) {
 
                                 int ret;
                                 int addr_type = *(objid - 1);
@@ -2013,7 +2555,7 @@ _get_realloc_symbol(const oid *objid, size_t objidlen,
                             *buf_overflow = 1;
                         }
                     } else {
-                        sprintf(intbuf, "%" NETSNMP_PRIo "u", *objid);
+                        *ulong_to_decimal(intbuf, *objid) = '\0';
                         if (!*buf_overflow
                             && !snmp_strcat(buf, buf_len, out_len,
                                             allow_realloc,
@@ -2022,7 +2564,7 @@ _get_realloc_symbol(const oid *objid, size_t objidlen,
                         }
                     }
                 } else {
-                    sprintf(intbuf, "%" NETSNMP_PRIo "u", *objid);
+                    *ulong_to_decimal(intbuf, *objid) = '\0';
                     if (!*buf_overflow && !snmp_strcat(buf, buf_len, out_len,
                                                        allow_realloc,
                                                        (const u_char *)
@@ -2035,7 +2577,7 @@ _get_realloc_symbol(const oid *objid, size_t objidlen,
                 break;
 
             case TYPE_TIMETICKS:
-                sprintf(intbuf, "%" NETSNMP_PRIo "u", *objid);
+                *ulong_to_decimal(intbuf, *objid) = '\0';
                 if (!*buf_overflow && !snmp_strcat(buf, buf_len, out_len,
                                                    allow_realloc,
                                                    (const u_char *)
@@ -2047,7 +2589,7 @@ _get_realloc_symbol(const oid *objid, size_t objidlen,
                 break;
 
             case TYPE_OBJID:
-                if (in_dices->isimplied) {
+                if (step->implied) {
                     numids = objidlen;
                 } else {
                     numids = (size_t) *objid + 1;
@@ -2064,9 +2606,7 @@ _get_realloc_symbol(const oid *objid, size_t objidlen,
             case TYPE_IPADDR:
                 if (objidlen < 4)
                     goto finish_it;
-                sprintf(intbuf, "%" NETSNMP_PRIo "u.%" NETSNMP_PRIo "u."
-                                "%" NETSNMP_PRIo "u.%" NETSNMP_PRIo "u",
-                        objid[0], objid[1], objid[2], objid[3]);
+                *oid_to_dotted_quad(intbuf, objid) = '\0';
                 objid += 4;
                 objidlen -= 4;
                 if (!*buf_overflow && !snmp_strcat(buf, buf_len, out_len,
@@ -2117,7 +2657,7 @@ _get_realloc_symbol(const oid *objid, size_t objidlen,
                                            (const u_char *) ".")) {
             *buf_overflow = 1;
         }
-        in_dices = in_dices->next;
+        step++;
     }
 
     finish_it:
@@ -2128,6 +2668,40 @@ _get_realloc_symbol(const oid *objid, size_t objidlen,
 }
 
 
+/*
+ * Prints objid as ".1.3.6...", without looking at the MIB tree.
+ */
+static int
+sprint_realloc_objid_numeric(u_char **buf, size_t *buf_len, size_t *out_len,
+                             int allow_realloc,
+                             const oid *objid, size_t objidlen) {
+    size_t needed = objidlen * (I64CHARSZ + 1) + 1;
+    char *cp;
+
+    while (*out_len + needed >= *buf_len) {
+        if (!(allow_realloc && snmp_realloc(buf, buf_len))) {
+            return 0;
+        }
+    }
+    cp = (char *) (*buf + *out_len);
+    while (objidlen--) {
+        *cp++ = '.';
+        cp = ulong_to_decimal(cp, *objid++);
+    }
+    *cp = '\0';
+    *out_len = cp - (char *) *buf;
+    return 1;
+}
+
+static const char *mib_prefixes[] = {
+        ".iso.org.dod.internet.mgmt.mib-2",
+        ".iso.org.dod.internet.experimental",
+        ".iso.org.dod.internet.private",
+        ".iso.org.dod.internet.snmpParties",
+        ".iso.org.dod.internet.snmpSecrets",
+        NULL
+};
+
 struct tree *
 netsnmp_sprint_realloc_objid_tree(u_char **buf, size_t *buf_len,
                                   size_t *out_len, int allow_realloc,
@@ -2138,7 +2712,20 @@ netsnmp_sprint_realloc_objid_tree(u_char **buf, size_t *buf_len,
     struct tree *subtree = tree_head;
     size_t midpoint_offset = 0;
     int tbuf_overflow = 0;
-    int output_format = NETSNMP_OID_OUTPUT_MODULE;
+    int output_format = oid_output_format;
+
+    /*
+     * Numeric output needs no labels, so only the node is looked up.
+     */
+    if (output_format == NETSNMP_OID_OUTPUT_NUMERIC
+        || output_format == NETSNMP_OID_OUTPUT_NONE) {
+        if (output_format == NETSNMP_OID_OUTPUT_NUMERIC && !*buf_overflow
+            && !sprint_realloc_objid_numeric(buf, buf_len, out_len,
+                                             allow_realloc, objid, objidlen)) {
+            *buf_overflow = 1;
+        }
+        return get_tree(objid, objidlen, tree_head);
+    }
 
     if ((tbuf = (u_char *) calloc(tbuf_len, 1)) == NULL) {
         tbuf_overflow = 1;
@@ -2147,6 +2734,7 @@ netsnmp_sprint_realloc_objid_tree(u_char **buf, size_t *buf_len,
         tout_len = 1;
     }
 
+    SNMP_PROBE1(symbol_lookup, objidlen);
     subtree = _get_realloc_symbol(objid, objidlen, subtree,
                                   &tbuf, &tbuf_len, &tout_len,
                                   allow_realloc, &tbuf_overflow, NULL,
@@ -2161,28 +2749,44 @@ netsnmp_sprint_realloc_objid_tree(u_char **buf, size_t *buf_len,
         return subtree;
     }
 
-    for (cp = tbuf; *cp; cp++);
+    if (output_format == NETSNMP_OID_OUTPUT_FULL) {
+        cp = tbuf;
+    } else if (output_format == NETSNMP_OID_OUTPUT_UCD) {
+        const char **pp;
+        size_t tlen = tout_len;
 
-    if (midpoint_offset != 0) {
-        cp = tbuf + midpoint_offset - 2;    /*  beyond the '.'  */
+        cp = tbuf;
+        for (pp = mib_prefixes; *pp; pp++) {
+            size_t ilen = strlen(*pp);
+            if (tlen > ilen && memcmp(tbuf, *pp, ilen) == 0) {
+                cp += ilen + 1;
+                break;
+            }
+        }
     } else {
+        for (cp = tbuf; *cp; cp++);
+
+        if (midpoint_offset != 0) {
+            cp = tbuf + midpoint_offset - 2;    /*  beyond the '.'  */
+        } else {
+            while (cp >= tbuf) {
+                if (isalpha(*cp)) {
+                    break;
+                }
+                cp--;
+            }
+        }
+
         while (cp >= tbuf) {
-            if (isalpha(*cp)) {
+            if (*cp == '.') {
                 break;
             }
             cp--;
         }
-    }
 
-    while (cp >= tbuf) {
-        if (*cp == '.') {
-            break;
-        }
-        cp--;
+        cp++;
     }
 
-    cp++;
-
     if ((NETSNMP_OID_OUTPUT_MODULE == output_format)
         && cp > tbuf) {
         char modbuf[256] = {0}, *mod =
@@ -3031,6 +3635,10 @@ free_partial_tree(struct tree *tp, int keep_label) {
     free_varbinds(&tp->varbinds);
     if (!keep_label)
         SNMP_FREE(tp->label);
+    free_display_hint(tp->hint_program);
+    tp->hint_program = NULL;
+    free_index_decoder(tp->index_decoder);
+    tp->index_decoder = NULL;
     SNMP_FREE(tp->hint);
     SNMP_FREE(tp->units);
     SNMP_FREE(tp->description);
@@ -3068,6 +3676,7 @@ tree_from_node(struct tree *tp, struct node *np) {
     np->varbinds = NULL;
     tp->hint = np->hint;
     np->hint = NULL;
+    tp->hint_program = compile_display_hint(tp->hint);
     tp->units = np->units;
     np->units = NULL;
     tp->description = np->description;
@@ -3409,9 +4018,11 @@ do_subtree(struct tree *root, struct node **nodes) {
                 anon_tp->enums = tp->enums;
                 anon_tp->indexes = tp->indexes;
                 anon_tp->augments = tp->augments;
+                anon_tp->index_decoder = tp->index_decoder;
                 anon_tp->varbinds = tp->varbinds;
                 anon_tp->ranges = tp->ranges;
                 anon_tp->hint = tp->hint;
+                anon_tp->hint_program = tp->hint_program;
                 anon_tp->units = tp->units;
                 anon_tp->description = tp->description;
                 anon_tp->reference = tp->reference;
@@ -5937,10 +6548,184 @@ read_all_mibs(void) {
     return tree_head;
 }
 
+void
+netsnmp_set_display_hints(int enabled) {
+    display_hints = enabled;
+    if (tree_head)
+        netsnmp_bind_printomats(tree_head);
+}
+
+int
+netsnmp_oid_output_format_by_name(const char *name) {
+    static const struct {
+        const char *name;
+        int format;
+    } formats[] = {
+            {"suffix",  NETSNMP_OID_OUTPUT_SUFFIX},
+            {"module",  NETSNMP_OID_OUTPUT_MODULE},
+            {"full",    NETSNMP_OID_OUTPUT_FULL},
+            {"numeric", NETSNMP_OID_OUTPUT_NUMERIC},
+            {"ucd",     NETSNMP_OID_OUTPUT_UCD},
+            {"none",    NETSNMP_OID_OUTPUT_NONE},
+    };
+    size_t i;
+
+    for (i = 0; i < sizeof(formats) / sizeof(formats[0]); i++) {
+        if (!strcmp(name, formats[i].name))
+            return formats[i].format;
+    }
+    return -1;
+}
+
+void
+netsnmp_set_oid_output_format(int format) {
+    oid_output_format = format;
+}
+
+/*
+ * Parses a numeric OID such as ".1.3.6.1", leading dot optional, into
+ * objid, which has room for *objidlen subids.  Returns 1 on success.
+ */
+static int
+parse_numeric_oid(const char *cp, oid *objid, size_t *objidlen) {
+    size_t len = 0;
+    char *end;
+
+    if (*cp == '.')
+        cp++;
+    while (*cp && len < *objidlen) {
+        if (!isdigit((u_char) *cp))
+            break;
+        objid[len++] = strtoul(cp, &end, 10);
+        cp = end;
+        if (*cp == '.' && isdigit((u_char) cp[1]))
+            cp++;
+    }
+    if (*cp || !len)
+        return 0;
+    *objidlen = len;
+    return 1;
+}
+
+/*
+ * Returns 1 on success, 0 if trap_oid is not a numeric OID.
+ */
+int
+netsnmp_add_oid_output_override(const char *trap_oid, int format) {
+    struct oid_output_override *ov;
+
+    if (!(ov = (struct oid_output_override *) calloc(1, sizeof(*ov))))
+        return 0;
+    ov->trap_oid_len = MAX_OID_LEN;
+    if (!parse_numeric_oid(trap_oid, ov->trap_oid, &ov->trap_oid_len)) {
+        free(ov);
+        return 0;
+    }
+    ov->format = format;
+    ov->next = oid_output_overrides;
+    oid_output_overrides = ov;
+    return 1;
+}
+
+/*
+ * Resolves name into objid, which has room for *objidlen subids.  name is
+ * a numeric OID, or a MIB object as "IF-MIB::linkDown" or "linkDown",
+ * optionally followed by numeric subids (".1").  Object names need
+ * init_mib() first.  Returns 1 on success, 0 if name does not resolve.
+ */
+int
+netsnmp_resolve_oid(const char *name, oid *objid, size_t *objidlen) {
+    char label[MAXTOKEN];
+    const char *cp, *sep;
+    struct tree *tp;
+    size_t len = 0, suffix_len;
+    int modid = -1;
+
+    if (isdigit((u_char) *name) || *name == '.')
+        return parse_numeric_oid(name, objid, objidlen);
+
+    if ((sep = strstr(name, "::"))) {
+        if ((size_t) (sep - name) >= sizeof(label))
+            return 0;
+        memcpy(label, name, sep - name);
+        label[sep - name] = '\0';
+        if ((modid = which_module(label)) == -1)
+            return 0;
+        name = sep + 2;
+    }
+    cp = name + strcspn(name, ".");
+    if (cp == name || (size_t) (cp - name) >= sizeof(label))
+        return 0;
+    memcpy(label, name, cp - name);
+    label[cp - name] = '\0';
+    if (!(tp = find_tree_node(label, modid)))
+        return 0;
+
+    for (struct tree *up = tp; up; up = up->parent)
+        len++;
+    if (len > *objidlen)
+        return 0;
+    for (size_t i = len; tp; tp = tp->parent)
+        objid[--i] = tp->subid;
+
+    if (*cp) {
+        suffix_len = *objidlen - len;
+        if (!parse_numeric_oid(cp, objid + len, &suffix_len))
+            return 0;
+        len += suffix_len;
+    }
+    *objidlen = len;
+    return 1;
+}
+
+void
+netsnmp_clear_oid_output_overrides(void) {
+    while (oid_output_overrides) {
+        struct oid_output_override *next = oid_output_overrides->next;
+        free(oid_output_overrides);
+        oid_output_overrides = next;
+    }
+}
+
+/*
+ * The OID output format for the variables of pdu.
+ */
+static int
+trap_oid_output_format(const snmp_pdu *pdu) {
+    const netsnmp_variable_list *vars;
+    const struct oid_output_override *ov;
+
+    if (!oid_output_overrides)
+        return oid_output_format;
+    for (vars = pdu->variables; vars; vars = vars->next_variable) {
+        if (vars->type == ASN_OBJECT_ID
+            && vars->name_length * sizeof(oid) == sizeof(snmptrap_oid)
+            && !memcmp(vars->name, snmptrap_oid, sizeof(snmptrap_oid)))
+            break;
+    }
+    if (!vars)
+        return oid_output_format;
+    for (ov = oid_output_overrides; ov; ov = ov->next) {
+        if (ov->trap_oid_len * sizeof(oid) == vars->val_len
+            && !memcmp(ov->trap_oid, vars->val.objid, vars->val_len))
+            return ov->format;
+    }
+    return oid_output_format;
+}
+
 void init_mib(const char *dirname) {
+    /*
+     * The tree is built once per directory; later calls reuse it.
+     */
+    if (tree_head && gLoadedMibDir && !strcmp(gLoadedMibDir, dirname))
+        return;
     netsnmp_init_mib_internals();
     add_mibdir(dirname);
     read_all_mibs();
+    netsnmp_bind_printomats(tree_head);
+    netsnmp_bind_index_decoders(tree_head);
+    free(gLoadedMibDir);
+    gLoadedMibDir = strdup(dirname);
 }
 
 int
@@ -5979,12 +6764,10 @@ sprint_realloc_variable(u_char **buf, size_t *buf_len,
                            (const u_char *)
                                    "No more variables left in this MIB View (It is past the end of the MIB tree)");
     } else if (subtree) {
-        const char *units = NULL;
-        const char *hint = NULL;
-
-        units = subtree->units;
-        hint = subtree->hint;
-
+        if (subtree->printomat) {
+            return subtree->printomat(buf, buf_len, out_len, allow_realloc,
+                                      variable, subtree);
+        }
         return sprint_realloc_by_type(buf, buf_len, out_len,
                                       allow_realloc, variable,
                                       subtree->enums, NULL,
@@ -6042,3 +6825,464 @@ realloc_format_plain_trap(u_char **buf, size_t *buf_len,
     return true;
 }
 
+/*
+ * Type names used by the structured trap formats.
+ */
+static const char *
+asn_type_name(u_char type) {
+    switch (type) {
+        case ASN_INTEGER:
+            return "INTEGER";
+        case ASN_OCTET_STR:
+            return "STRING";
+        case ASN_BIT_STR:
+            return "BITS";
+        case ASN_OBJECT_ID:
+            return "OID";
+        case ASN_NULL:
+            return "NULL";
+        case ASN_IPADDRESS:
+            return "IpAddress";
+        case ASN_COUNTER:
+            return "Counter32";
+        case ASN_GAUGE:
+            return "Gauge32";
+        case ASN_TIMETICKS:
+            return "Timeticks";
+        case ASN_OPAQUE:
+            return "Opaque";
+        case ASN_COUNTER64:
+            return "Counter64";
+        case ASN_UINTEGER:
+            return "UInteger32";
+        case SNMP_NOSUCHOBJECT:
+            return "noSuchObject";
+        case SNMP_NOSUCHINSTANCE:
+            return "noSuchInstance";
+        case SNMP_ENDOFMIBVIEW:
+            return "endOfMibView";
+        default:
+            return "unknown";
+    }
+}
+
+/*
+ * Type labels the sprint_realloc_* printers put in front of a value; the
+ * structured formats carry the type in a field of its own.
+ */
+static const char *const value_labels[] = {
+        "INTEGER: ", "STRING: ", "Hex-STRING: ", "BITS: ", "OID: ",
+        "Timeticks: ", "Gauge32: ", "Counter32: ", "Counter64: ",
+        "IpAddress: ", "Network Address: ", NULL
+};
+
+static size_t
+value_label_len(const u_char *cp, size_t len) {
+    const char *const *lp;
+    size_t n;
+
+    for (lp = value_labels; *lp; lp++) {
+        n = strlen(*lp);
+        if (n <= len && !memcmp(cp, *lp, n))
+            return n;
+    }
+    return 0;
+}
+
+/*
+ * Makes room for len more characters plus a NUL.
+ */
+static int
+snmp_reserve(u_char **buf, size_t *buf_len, size_t out_len,
+             int allow_realloc, size_t len) {
+    while ((out_len + len + 1) >= *buf_len) {
+        if (!(allow_realloc && snmp_realloc(buf, buf_len))) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/*
+ * Appends cp[0..len) as the body of a JSON string (NETSNMP_TRAP_OUTPUT_JSON)
+ * or of a double-quoted key=value field (NETSNMP_TRAP_OUTPUT_KV).  Octets
+ * outside printable ASCII are written as \u00XX resp. \xXX, so the record
+ * stays valid whatever the agent sent.
+ */
+static int
+sprint_realloc_escaped(u_char **buf, size_t *buf_len, size_t *out_len,
+                       int allow_realloc, int format,
+                       const u_char *cp, size_t len) {
+    static const char hex[] = "0123456789abcdef";
+    u_char *op;
+    size_t i;
+
+    if (!snmp_reserve(buf, buf_len, *out_len, allow_realloc, 6 * len))
+        return 0;
+    op = *buf + *out_len;
+    for (i = 0; i < len; i++) {
+        u_char ch = cp[i];
+
+        if (ch == '"' || ch == '\\') {
+            *op++ = '\\';
+            *op++ = ch;
+        } else if (ch >= 0x20 && ch < 0x7f) {
+            *op++ = ch;
+        } else if (format == NETSNMP_TRAP_OUTPUT_JSON) {
+            *op++ = '\\';
+            switch (ch) {
+                case '\n':
+                    *op++ = 'n';
+                    break;
+                case '\r':
+                    *op++ = 'r';
+                    break;
+                case '\t':
+                    *op++ = 't';
+                    break;
+                default:
+                    memcpy(op, "u00", 3);
+                    op += 3;
+                    *op++ = hex[ch >> 4];
+                    *op++ = hex[ch & 0x0F];
+            }
+        } else {
+            *op++ = '\\';
+            *op++ = 'x';
+            *op++ = hex[ch >> 4];
+            *op++ = hex[ch & 0x0F];
+        }
+    }
+    *out_len = op - *buf;
+    *op = '\0';
+    return 1;
+}
+
+/*
+ * Appends the value as received, in a canonical text form: numbers in
+ * decimal, OIDs numeric, IpAddress dotted and octet strings as contiguous
+ * lower case hex.
+ */
+static int
+sprint_realloc_raw_value(u_char **buf, size_t *buf_len, size_t *out_len,
+                         int allow_realloc,
+                         const netsnmp_variable_list *var) {
+    char *op;
+    size_t i;
+
+    switch (var->type) {
+        case ASN_INTEGER: {
+            char str[32];
+            snprintf(str, sizeof(str), "%ld", *var->val.integer);
+            return snmp_cstrcat(buf, buf_len, out_len, allow_realloc, str);
+        }
+        case ASN_COUNTER:
+        case ASN_GAUGE:
+        case ASN_TIMETICKS:
+        case ASN_UINTEGER: {
+            char str[32];
+            snprintf(str, sizeof(str), "%lu",
+                     (u_long) *var->val.integer & 0xffffffff);
+            return snmp_cstrcat(buf, buf_len, out_len, allow_realloc, str);
+        }
+        case ASN_COUNTER64: {
+            char a64buf[I64CHARSZ + 1];
+            printU64(a64buf, var->val.counter64);
+            return snmp_cstrcat(buf, buf_len, out_len, allow_realloc, a64buf);
+        }
+        case ASN_OBJECT_ID:
+            if (!snmp_reserve(buf, buf_len, *out_len, allow_realloc,
+                              var->val_len / sizeof(oid) * (I64CHARSZ + 1)))
+                return 0;
+            op = (char *) *buf + *out_len;
+            for (i = 0; i < var->val_len / sizeof(oid); i++) {
+                if (i)
+                    *op++ = '.';
+                op = ulong_to_decimal(op, var->val.objid[i]);
+            }
+            break;
+        case ASN_IPADDRESS:
+            if (!snmp_reserve(buf, buf_len, *out_len, allow_realloc,
+                              var->val_len * 4))
+                return 0;
+            op = (char *) *buf + *out_len;
+            for (i = 0; i < var->val_len; i++) {
+                if (i)
+                    *op++ = '.';
+                op = ulong_to_decimal(op, var->val.string[i]);
+            }
+            break;
+        case ASN_OCTET_STR:
+        case ASN_BIT_STR:
+        case ASN_OPAQUE:
+            if (!snmp_reserve(buf, buf_len, *out_len, allow_realloc,
+                              var->val_len * 2))
+                return 0;
+            op = (char *) *buf + *out_len;
+            for (i = 0; i < var->val_len; i++) {
+                *op++ = "0123456789abcdef"[var->val.string[i] >> 4];
+                *op++ = "0123456789abcdef"[var->val.string[i] & 0x0F];
+            }
+            break;
+        default:
+            return 1;
+    }
+    *out_len = op - (char *) *buf;
+    *(*buf + *out_len) = '\0';
+    return 1;
+}
+
+/*
+ * Renders the value of var as the plain format would, minus the type label.
+ * Octet strings are not quoted: a printable string is its own value, other
+ * strings are shown in hex, unless a DISPLAY-HINT applies.
+ */
+static int
+sprint_realloc_field_value(u_char **buf, size_t *buf_len, size_t *out_len,
+                           int allow_realloc,
+                           const netsnmp_variable_list *var,
+                           const struct tree *subtree) {
+    size_t start = *out_len, skip;
+
+    if (var->type == ASN_OCTET_STR) {
+        const struct display_hint *hint =
+                (display_hints && subtree) ? subtree->hint_program : NULL;
+        const char *units =
+                (display_hints && subtree) ? subtree->units : NULL;
+        int rc = -1;
+
+        if (hint) {
+            rc = sprint_realloc_hint_program(buf, buf_len, out_len,
+                                             allow_realloc, var->val.string,
+                                             var->val_len, hint);
+            if (rc < 0)
+                *out_len = start;
+        }
+        if (rc < 0) {
+            if (octet_string_is_printable(var->val.string, var->val_len)) {
+                if (!snmp_reserve(buf, buf_len, *out_len, allow_realloc,
+                                  var->val_len))
+                    return 0;
+                memcpy(*buf + *out_len, var->val.string, var->val_len);
+                *out_len += var->val_len;
+                *(*buf + *out_len) = '\0';
+            } else if (var->val_len) {
+                if (!_sprint_hexstring_line(buf, buf_len, out_len,
+                                            allow_realloc, var->val.string,
+                                            var->val_len))
+                    return 0;
+                *(*buf + --(*out_len)) = '\0';  /* trailing blank */
+            }
+            rc = 1;
+        }
+        if (rc && units) {
+            return (snmp_cstrcat(buf, buf_len, out_len, allow_realloc, " ")
+                    && snmp_cstrcat(buf, buf_len, out_len, allow_realloc,
+                                    units));
+        }
+        return rc;
+    }
+
+    if (var->type == SNMP_NOSUCHOBJECT || var->type == SNMP_NOSUCHINSTANCE
+        || var->type == SNMP_ENDOFMIBVIEW) {
+        return 1;
+    }
+    if (subtree && subtree->printomat) {
+        if (!subtree->printomat(buf, buf_len, out_len, allow_realloc, var,
+                                subtree))
+            return 0;
+    } else if (!sprint_realloc_by_type(buf, buf_len, out_len, allow_realloc,
+                                       var, subtree ? subtree->enums : NULL,
+                                       NULL, NULL)) {
+        return 0;
+    }
+
+    skip = value_label_len(*buf + start, *out_len - start);
+    if (skip) {
+        memmove(*buf + start, *buf + start + skip, *out_len - start - skip);
+        *out_len -= skip;
+        *(*buf + *out_len) = '\0';
+    }
+    return 1;
+}
+
+/*
+ * Appends one field of a varbind record.  Values of quoted fields are
+ * escaped, the others are known to need no escaping.
+ */
+static int
+sprint_realloc_trap_field(u_char **buf, size_t *buf_len, size_t *out_len,
+                          int allow_realloc, int format, int index,
+                          const char *key, const u_char *val, size_t len,
+                          int quoted) {
+    char prefix[48];
+
+    if (format == NETSNMP_TRAP_OUTPUT_JSON) {
+        snprintf(prefix, sizeof(prefix), "%s\"%s\":\"",
+                 strcmp(key, "oid") ? "," : "{", key);
+        quoted = 1;
+    } else {
+        snprintf(prefix, sizeof(prefix), "%svb%d.%s=%s",
+                 (index || strcmp(key, "oid")) ? " " : "", index, key,
+                 quoted ? "\"" : "");
+    }
+    if (!snmp_cstrcat(buf, buf_len, out_len, allow_realloc, prefix))
+        return 0;
+    if (quoted) {
+        if (!sprint_realloc_escaped(buf, buf_len, out_len, allow_realloc,
+                                    format, val, len))
+            return 0;
+        return snmp_cstrcat(buf, buf_len, out_len, allow_realloc, "\"");
+    }
+    if (!snmp_reserve(buf, buf_len, *out_len, allow_realloc, len))
+        return 0;
+    memcpy(*buf + *out_len, val, len);
+    *out_len += len;
+    *(*buf + *out_len) = '\0';
+    return 1;
+}
+
+/**
+ * Formats the variables of a trap as structured records, straight from the
+ * decoded PDU.  Every varbind carries its numeric OID, symbolic name, type,
+ * raw value and rendered value as separate fields:
+ *
+ * NETSNMP_TRAP_OUTPUT_JSON:
+ *   {"varbinds":[{"oid":"1.3.6.1.2.1.1.3.0","name":"SNMPv2-MIB::sysUpTime.0",
+ *   "type":"Timeticks","raw":"123456","value":"(123456) 0:20:34.56"},...]}
+ *
+ * NETSNMP_TRAP_OUTPUT_KV:
+ *   vb0.oid=1.3.6.1.2.1.1.3.0 vb0.name="SNMPv2-MIB::sysUpTime.0"
+ *   vb0.type=Timeticks vb0.raw=123456 vb0.value="(123456) 0:20:34.56" ...
+ *
+ * Input Parameters:
+ *    buf, buf_len, out_len, allow_realloc - standard relocatable
+ *                                           buffer parameters
+ *    pdu       - the pdu information
+ *    format    - NETSNMP_TRAP_OUTPUT_JSON or NETSNMP_TRAP_OUTPUT_KV
+ *
+ * Returns true if the output was completed successfully or false if it is
+ * truncated due to a memory allocation failure.
+ */
+bool
+realloc_format_structured_trap(u_char **buf, size_t *buf_len,
+                               size_t *out_len, bool allow_realloc,
+                               snmp_pdu *pdu, int format) {
+    netsnmp_variable_list *vars;
+    struct tree *subtree;
+    size_t scratch_len = 256, scratch_out;
+    u_char *scratch;
+    int index = 0, buf_overflow, ok = 0;
+
+    if (!(scratch = (u_char *) malloc(scratch_len)))
+        return false;
+    if (format == NETSNMP_TRAP_OUTPUT_JSON &&
+        !snmp_cstrcat(buf, buf_len, out_len, allow_realloc, "{\"varbinds\":["))
+        goto done;
+
+    for (vars = pdu->variables; vars != NULL;
+         vars = vars->next_variable, index++) {
+        if (format == NETSNMP_TRAP_OUTPUT_JSON && index &&
+            !snmp_cstrcat(buf, buf_len, out_len, allow_realloc, ","))
+            goto done;
+
+        /*
+         * oid
+         */
+        scratch_out = 0;
+        {
+            netsnmp_variable_list name = {};
+            name.type = ASN_OBJECT_ID;
+            name.val.objid = vars->name;
+            name.val_len = vars->name_length * sizeof(oid);
+            if (!sprint_realloc_raw_value(&scratch, &scratch_len,
+                                          &scratch_out, 1, &name))
+                goto done;
+        }
+        if (!sprint_realloc_trap_field(buf, buf_len, out_len, allow_realloc,
+                                       format, index, "oid", scratch,
+                                       scratch_out, 0))
+            goto done;
+
+        /*
+         * name
+         */
+        scratch_out = 0;
+        buf_overflow = 0;
+        subtree = netsnmp_sprint_realloc_objid_tree(&scratch, &scratch_len,
+                                                    &scratch_out, 1,
+                                                    &buf_overflow,
+                                                    vars->name,
+                                                    vars->name_length);
+        if (buf_overflow ||
+            !sprint_realloc_trap_field(buf, buf_len, out_len, allow_realloc,
+                                       format, index, "name", scratch,
+                                       scratch_out, 1))
+            goto done;
+
+        /*
+         * type
+         */
+        if (!sprint_realloc_trap_field(buf, buf_len, out_len, allow_realloc,
+                                       format, index, "type",
+                                       (const u_char *) asn_type_name(vars->type),
+                                       strlen(asn_type_name(vars->type)), 0))
+            goto done;
+
+        /*
+         * raw
+         */
+        scratch_out = 0;
+        if (!sprint_realloc_raw_value(&scratch, &scratch_len, &scratch_out, 1,
+                                      vars) ||
+            !sprint_realloc_trap_field(buf, buf_len, out_len, allow_realloc,
+                                       format, index, "raw", scratch,
+                                       scratch_out, 0))
+            goto done;
+
+        /*
+         * value
+         */
+        scratch_out = 0;
+        if (!sprint_realloc_field_value(&scratch, &scratch_len, &scratch_out,
+                                        1, vars, subtree) ||
+            !sprint_realloc_trap_field(buf, buf_len, out_len, allow_realloc,
+                                       format, index, "value", scratch,
+                                       scratch_out, 1))
+            goto done;
+
+        if (format == NETSNMP_TRAP_OUTPUT_JSON &&
+            !snmp_cstrcat(buf, buf_len, out_len, allow_realloc, "}"))
+            goto done;
+    }
+    if (format == NETSNMP_TRAP_OUTPUT_JSON &&
+        !snmp_cstrcat(buf, buf_len, out_len, allow_realloc, "]}"))
+        goto done;
+    ok = 1;
+
+  done:
+    free(scratch);
+    return ok;
+}
+
+/**
+ * Formats a trap in the given NETSNMP_TRAP_OUTPUT_* format.
+ */
+bool
+realloc_format_trap(u_char **buf, size_t *buf_len, size_t *out_len,
+                    bool allow_realloc, snmp_pdu *pdu, int format) {
+    int saved_oid_format = oid_output_format;
+    bool ok;
+
+    if (format == NETSNMP_TRAP_OUTPUT_NONE)
+        return true;
+    oid_output_format = trap_oid_output_format(pdu);
+    if (format == NETSNMP_TRAP_OUTPUT_PLAIN)
+        ok = realloc_format_plain_trap(buf, buf_len, out_len, allow_realloc,
+                                       pdu);
+    else
+        ok = realloc_format_structured_trap(buf, buf_len, out_len,
+                                            allow_realloc, pdu, format);
+    oid_output_format = saved_oid_format;
+    return ok;
+}
@@ -406,6 +406,69 @@ static struct tok tokens[] = {
           int             low, high;
       };
 
+struct tree;
+
+/*
+ * Prints a variable of a MIB node, using the node's enums, hint and units.
+ */
+typedef int     (*node_printer) (u_char **, size_t *, size_t *, int,
+                                 const netsnmp_variable_list *,
+                                 const struct tree *);
+
+/*
+ * One octet-format specification of a DISPLAY-HINT clause
+ * (RFC 2579 section 3.1): [*]width code [separator [terminator]].
+ */
+struct hint_spec {
+    int             width;  /* octets consumed per value (max for 'a'/'t') */
+    char            code;   /* 'a', 't', 'd', 'o', 'x'; anything else is bad */
+    char            separ;  /* printed between values, 0 if none */
+    char            term;   /* printed after a repeat group, 0 if none */
+    u_char          star;   /* repeat count is read from the data */
+    u_char          pad;    /* zero-pad single hex digits */
+};
+
+/*
+ * Shapes of DISPLAY-HINT clauses that have a dedicated formatter.
+ */
+#define DISPLAY_HINT_GENERIC        0
+#define DISPLAY_HINT_STRING         1   /* "255a"   DisplayString, SnmpAdminString */
+#define DISPLAY_HINT_HEX_OCTETS     2   /* "1x:"    MacAddress, PhysAddress */
+#define DISPLAY_HINT_DATEANDTIME    3   /* "2d-1d-1d,1d:1d:1d.1d,1a1d:1d" */
+#define DISPLAY_HINT_IPV4           4   /* "1d.1d.1d.1d" InetAddressIPv4 */
+#define DISPLAY_HINT_IPV6           5   /* "2x:2x:2x:2x:2x:2x:2x:2x" InetAddressIPv6 */
+
+/*
+ * A DISPLAY-HINT clause parsed once into a list of specifications, so
+ * printing a value only runs the list.  Integer hints keep the format
+ * code and the implied decimal point of "d-N".
+ */
+struct display_hint {
+    const char     *text;   /* the clause as written, not owned */
+    int             kind;   /* DISPLAY_HINT_* */
+    char            int_code;
+    int             int_shift;
+    int             nspecs;
+    struct hint_spec *specs;
+};
+
+/*
+ * The INDEX clause of a table entry with each index object looked up once,
+ * so the instance part of a column OID can be decoded without name
+ * lookups.  An entry that AUGMENTS another uses the other's indexes.
+ */
+struct index_step {
+    struct tree    *tp;     /* index object, NULL if not in the MIBs */
+    int             fixed_len;      /* fixed-size OCTET STRING, else -1 */
+    u_char          implied;
+    u_char          inet_address;   /* InetAddress next to an InetAddressType */
+};
+
+struct index_decoder {
+    int             nsteps; /* 0: the entry has no usable indexes */
+    struct index_step *steps;
+};
+
 /*
      * A tree in the format of the tree structure of the MIB.
      */
@@ -427,13 +490,12 @@ static struct tok tokens[] = {
         struct range_list *ranges;
         struct index_list *indexes;
         char           *augments;
+        struct index_decoder *index_decoder;    /* built by netsnmp_bind_index_decoders() */
         struct varbind_list *varbinds;
         char           *hint;
+        struct display_hint *hint_program;      /* hint compiled at load time */
         char           *units;
-        int             (*printomat) (u_char **, size_t *, size_t *, int,
-                                      const netsnmp_variable_list *,
-                                      const struct enum_list *, const char *,
-                                      const char *);
+        node_printer    printomat;      /* value printer bound at load time */
         void            (*printer) (char *, const netsnmp_variable_list *, const struct enum_list *, const char *, const char *);   /* Value printing function */
         char           *description;    /* description (a quoted string) */
         char           *reference;    /* references (a quoted string) */
@@ -634,6 +696,7 @@ struct varbind_list {
 
 
 static int gLoop = 0;
+static int display_hints = 0;   /* see netsnmp_set_display_hints() */
 static char *gpMibErrorString;
 #define STRINGMAX 1024
 static char gMibNames[STRINGMAX];
@@ -685,8 +748,91 @@ sprint_realloc_timeticks(u_char ** buf, size_t * buf_len, size_t * out_len,
                          const struct enum_list *enums,
                          const char *hint, const char *units);
 
+/**
+ * Parses a DISPLAY-HINT clause into a struct display_hint.
+ *
+ * @param hint  Contents of the DISPLAY-HINT clause, must outlive the result.
+ *
+ * @return the compiled hint, to be released with free_display_hint(),
+ *         or NULL if hint is NULL or memory is exhausted.
+ */
+struct display_hint *
+compile_display_hint(const char *hint);
+void
+free_display_hint(struct display_hint *hint);
+
+int
+sprint_realloc_by_type_hinted(u_char ** buf, size_t * buf_len,
+                              size_t * out_len, int allow_realloc,
+                              const netsnmp_variable_list * var,
+                              const struct enum_list *enums,
+                              const struct display_hint *hint,
+                              const char *units);
+
+/*
+ * Apply the DISPLAY-HINT and UNITS clauses of the MIB object when printing
+ * variable values (off by default: values are printed by their ASN.1 type
+ * only).
+ */
+void
+netsnmp_set_display_hints(int enabled);
+
+void
+netsnmp_bind_printomats(struct tree *tp);
+void
+netsnmp_bind_index_decoders(struct tree *tp);
+
+/* snmpTrapOID.0, the varbind an SNMPv2-Trap names its trap with */
+inline constexpr oid snmptrap_oid[] = {1, 3, 6, 1, 6, 3, 1, 1, 4, 1, 0};
+
+/*
+ * How object identifiers are printed, one of NETSNMP_OID_OUTPUT_*.  The
+ * override applies to the variables of traps whose snmpTrapOID.0 is
+ * trap_oid, a numeric OID such as ".1.3.6.1.6.3.1.1.5.3".
+ */
+struct oid_output_override {
+    struct oid_output_override *next;
+    oid             trap_oid[MAX_OID_LEN];
+    size_t          trap_oid_len;
+    int             format;
+};
+
+int
+netsnmp_oid_output_format_by_name(const char *name);
+void
+netsnmp_set_oid_output_format(int format);
+int
+netsnmp_add_oid_output_override(const char *trap_oid, int format);
+void
+netsnmp_clear_oid_output_overrides(void);
+int
+netsnmp_resolve_oid(const char *name, oid *objid, size_t *objidlen);
+
+struct tree *
+get_tree(const oid * objid, size_t objidlen, struct tree *subtree);
+struct tree *
+get_tree_head(void);
+
 bool
 realloc_format_plain_trap(u_char ** buf, size_t * buf_len,
                           size_t * out_len, bool allow_realloc,
                           snmp_pdu *pdu);
+
+/*
+ * Trap output formats, see realloc_format_trap().
+ */
+#define NETSNMP_TRAP_OUTPUT_PLAIN   0   /* name = TYPE: value, ... */
+#define NETSNMP_TRAP_OUTPUT_JSON    1
+#define NETSNMP_TRAP_OUTPUT_KV      2   /* key=value pairs */
+#define NETSNMP_TRAP_OUTPUT_NONE    3   /* no text, TrapRecord only */
+
+bool
+realloc_format_structured_trap(u_char ** buf, size_t * buf_len,
+                               size_t * out_len, bool allow_realloc,
+                               snmp_pdu *pdu, int format);
+
+bool
+realloc_format_trap(u_char ** buf, size_t * buf_len,
+                    size_t * out_len, bool allow_realloc,
+                    snmp_pdu *pdu, int format);
 #endif // MIB_HANDLER_H
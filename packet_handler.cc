@@ -1,43 +1,113 @@
 #include "packet_handler.h"
+#include "varbind_reader.h"
+#include "snmp_probes.h"
+#include "timestamp_format.h"
 #include "memory"
+#include <chrono>
+#include <cstring>
+#include <mutex>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
 
-std::string HandleMibPacket(u_char* data, size_t packet_size, const char* mib_dir) {
+/*
+ * Finds snmpTrapOID.0 among the first two varbinds, where an SNMPv2-Trap
+ * puts it after sysUpTime.0, decoding nothing else.  Returns false if the
+ * varbinds are malformed, leaving trap_oid_len 0 if there is no trap OID.
+ */
+static bool
+peek_trap_oid(std::span<const uint8_t> varbinds, oid* trap_oid, size_t* trap_oid_len){
+    VarBindReader reader(varbinds);
+    VarBindView   vb;
+    oid           name[MAX_OID_LEN];
+    size_t        name_len;
+    size_t        room = *trap_oid_len;
+    u_char        type;
 
-    auto pdu = std::make_shared<snmp_pdu>();
-    if(!parse_pdu(data, &packet_size, pdu.get())){
-        return std::string();
+    *trap_oid_len = 0;
+    for(int i = 0; i < 2 && reader.Next(vb); i++){
+        name_len = MAX_OID_LEN;
+        if(!BerReader(vb.name).ReadObjid(type, name, name_len)){
+            return false;
+        }
+        if(name_len == OID_LENGTH(snmptrap_oid) && !memcmp(name, snmptrap_oid, sizeof(snmptrap_oid))){
+            *trap_oid_len = room;
+            return vb.type == ASN_OBJECT_ID && BerReader(vb.value).ReadObjid(type, trap_oid, *trap_oid_len);
+        }
     }
+    return reader.Error() < 0;
+}
+
+std::shared_ptr<TrapRecord> DecodeTrap(u_char* data, size_t packet_size, const char* mib_dir, int* error,
+                                       TrapOidFilter* filter, CommunityAllowlist* communities) {
+
+    SNMP_PROBE1(parse_start, packet_size);
+    auto pdu = std::make_unique<snmp_pdu>();
+    std::span<const uint8_t> varbinds;
+    int rc = parse_pdu_header(data, packet_size, pdu.get(), &varbinds, communities);
+    if(rc == SNMPERR_SUCCESS && filter){
+        oid    trap_oid[MAX_OID_LEN];
+        size_t trap_oid_len = MAX_OID_LEN;
+        /* malformed varbinds are left to the full parse, which counts them */
+        if(peek_trap_oid(varbinds, trap_oid, &trap_oid_len)
+           && filter->Evaluate(std::span<const oid>(trap_oid, trap_oid_len)) == TrapOidFilter::DENY){
+            if(error){
+                *error = SNMPERR_SUCCESS;
+            }
+            SNMP_PROBE2(parse_end, SNMPERR_SUCCESS, 0);
+            return nullptr;
+        }
+    }
+    if(rc == SNMPERR_SUCCESS){
+        rc = parse_var_binds(varbinds, pdu.get());
+    }
+    if(error){
+        *error = rc;
+    }
+    /* a truncated varbind list still yields the variables before the error */
+    if(rc != SNMPERR_SUCCESS && !pdu->variables){
+        SNMP_PROBE2(parse_end, rc, 0);
+        return nullptr;
+    }
+    SNMP_PROBE2(parse_end, rc, 1);
 
     init_mib(mib_dir);
 
-    size_t          r_len = 64, o_len = 0;
-    u_char* parsed_trap = new u_char[r_len];
-    realloc_format_plain_trap(&parsed_trap, &r_len, &o_len, true, pdu.get());
+    return std::make_shared<TrapRecord>(std::move(pdu));
+}
+
+std::string FormatTrap(const TrapRecord& record, int output_format) {
 
+    size_t          r_len = 64, o_len = 0;
+    u_char* parsed_trap = (u_char*) malloc(r_len);
     if(!parsed_trap){
         return std::string();
     }
-    return std::string(reinterpret_cast<const char*>(parsed_trap), o_len);
+    realloc_format_trap(&parsed_trap, &r_len, &o_len, true, record.GetPdu(), output_format);
+
+    SNMP_PROBE1(format_end, o_len);
+    std::string text(reinterpret_cast<const char*>(parsed_trap), o_len);
+    free(parsed_trap);
+    return text;
+}
+
+std::string HandleMibPacket(u_char* data, size_t packet_size, const char* mib_dir, int output_format) {
 
+    auto record = DecodeTrap(data, packet_size, mib_dir);
+    if(!record){
+        return std::string();
+    }
+    return FormatTrap(*record, output_format);
 }
 
 std::string AddTimestamp(){
-    time_t          now;        /* the current time */
-    struct tm      *now_parsed; /* time in struct format */
-    time(&now);
-    now_parsed = localtime(&now);
-    char            safe_bfr[200];     /* holds other strings */
-    sprintf(safe_bfr, "%.4d-%.2d-%.2d %.2d:%.2d:%.2d ",
-            now_parsed->tm_year + 1900, now_parsed->tm_mon + 1,
-            now_parsed->tm_mday, now_parsed->tm_hour,
-            now_parsed->tm_min, now_parsed->tm_sec);
-    return std::string(safe_bfr);
+    /* localtime only runs once a second per thread */
+    thread_local TimestampFormatter formatter;
+    return formatter.Now();
 }
 
 /*
  * XXX  What if we have multiple addresses?  Or no addresses for that matter?
- * XXX  Could it be computed once then cached?  Probably not worth it (not
- *                                                           used very often).
+ * Walks every interface, so traps go through get_cached_myaddr() below.
  */
 in_addr_t
 get_myaddr(void)
@@ -120,15 +190,71 @@ get_myaddr(void)
     return 0;
 }
 
-std::string AddTransportInfo(std::string& client_ip, unsigned short client_port, int host_port){
-    std::string transport_info("UDP: ");
-    transport_info = transport_info + "[" + client_ip + "]";
+/*
+ * get_myaddr(), kept until the kernel reports a change of interfaces or
+ * their IPv4 addresses on a netlink socket.  That socket is read without
+ * blocking at most once a second, so in between a lookup makes no system
+ * call at all.  Without netlink the address is looked up once a second.
+ */
+static in_addr_t
+get_cached_myaddr(void)
+{
+    static std::mutex                            lock;
+    static int                                   nl = -2;   /* not opened yet */
+    static bool                                  stale = true;
+    static in_addr_t                             addr;
+    static std::chrono::steady_clock::time_point checked;
+    std::lock_guard<std::mutex>                  guard(lock);
 
-    transport_info = transport_info + ":" + std::to_string(client_port) + "->";
+    auto now = std::chrono::steady_clock::now();
+    if (nl == -2) {
+        struct sockaddr_nl local;
+        memset(&local, 0, sizeof(local));
+        local.nl_family = AF_NETLINK;
+        local.nl_groups = RTMGRP_LINK | RTMGRP_IPV4_IFADDR;
+        nl = socket(AF_NETLINK, SOCK_RAW | SOCK_NONBLOCK | SOCK_CLOEXEC, NETLINK_ROUTE);
+        if (nl >= 0 && bind(nl, (struct sockaddr *) &local, sizeof(local)) < 0) {
+            close(nl);
+            nl = -1;
+        }
+    }
+    if (!stale && now - checked >= std::chrono::seconds(1)) {
+        checked = now;
+        if (nl < 0) {
+            stale = true;
+        } else {
+            /* any event will do, or an overrun that lost some */
+            char    buf[4096];
+            ssize_t n;
+            while ((n = recv(nl, buf, sizeof(buf), MSG_DONTWAIT)) > 0 || (n < 0 && errno == ENOBUFS)) {
+                stale = true;
+            }
+        }
+    }
+    if (stale) {
+        addr    = get_myaddr();
+        stale   = false;
+        checked = now;
+    }
+    return addr;
+}
 
-    in_addr_t hostAddress = get_myaddr();
+std::string AddTransportInfo(std::string& client_ip, unsigned short client_port, int host_port){
+    in_addr_t hostAddress = get_cached_myaddr();
     char hostAddressStr[INET_ADDRSTRLEN];
     inet_ntop(AF_INET, &hostAddress, hostAddressStr, sizeof(hostAddressStr));
-    transport_info =  transport_info + "[" + std::string(hostAddressStr) + "]:" + std::to_string(host_port);
+    return AddTransportInfo(client_ip, client_port, hostAddressStr, host_port);
+}
+
+std::string AddTransportInfo(const std::string& client_ip, unsigned short client_port, const std::string& host_ip,
+                             int host_port){
+    std::string transport_info("UDP: [");
+    transport_info += client_ip;
+    transport_info += "]:";
+    transport_info += std::to_string(client_port);
+    transport_info += "->[";
+    transport_info += host_ip;
+    transport_info += "]:";
+    transport_info += std::to_string(host_port);
     return transport_info;
 }
@@ -3,15 +3,52 @@
 
 #include "packet_parser.h"
 #include "mib_handler.h"
+#include "trap_record.h"
+#include "trap_filter.h"
+#include "community_allowlist.h"
 #include <sys/ioctl.h>
 #include <net/if.h>
 #include <unistd.h>
+#include <memory>
 #include <string>
 
-std::string HandleMibPacket(u_char* received_packet, size_t packet_size, const char* mib_dir);
+/*
+ * Parses an SNMPv2c trap and resolves its variables against the MIBs in
+ * mib_dir.  Returns nullptr if no variable could be decoded.  When error
+ * is given it receives the SNMPERR_* code of the parse, which is set even
+ * for a trap returned with only the variables before a bad one.
+ *
+ * With a filter, the trap OID is checked against it before the varbinds
+ * are decoded, and a denied trap returns nullptr with SNMPERR_SUCCESS.
+ * With communities, a trap sent with another community returns nullptr
+ * with SNMPERR_AUTHENTICATION_FAILURE.
+ */
+std::shared_ptr<TrapRecord> DecodeTrap(u_char* received_packet, size_t packet_size, const char* mib_dir,
+                                       int* error = nullptr, TrapOidFilter* filter = nullptr,
+                                       CommunityAllowlist* communities = nullptr);
 
+/*
+ * Renders a decoded trap as text in one of the NETSNMP_TRAP_OUTPUT_* formats.
+ */
+std::string FormatTrap(const TrapRecord& record, int output_format);
+
+std::string HandleMibPacket(u_char* received_packet, size_t packet_size, const char* mib_dir,
+                            int output_format = NETSNMP_TRAP_OUTPUT_PLAIN);
+
+/*
+ * The current local time as "YYYY-MM-DD HH:MM:SS ".  See TimestampFormatter
+ * for finer precision or another time.
+ */
 std::string AddTimestamp();
 
+/*
+ * "UDP: [client_ip]:client_port->[host_ip]:host_port".  Without host_ip,
+ * the first IPv4 address of an interface that is up and not loopback is
+ * used, which the trap did not necessarily arrive on.
+ */
 std::string AddTransportInfo(std::string& client_ip, unsigned short client_port, int host_port);
 
+std::string AddTransportInfo(const std::string& client_ip, unsigned short client_port, const std::string& host_ip,
+                             int host_port);
+
 #endif //SNMP_SHARED_LIB_PACKET_HANDLER_H
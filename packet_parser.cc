@@ -1,7 +1,44 @@
 #include "packet_parser.h"
-#include <iostream>
+#include "ber_reader.h"
+#include "varbind_reader.h"
+#include "community_allowlist.h"
+#include "thread_counters.h"
+#include "snmp_probes.h"
 #include <cstring>
 
+static ThreadCounters<ASN_ERR_CLASSES> asn_errors;
+
+/*
+ * Counts a decoding error and returns NULL for the caller to pass on.
+ * Bad input is only counted, never printed, so a flood of it costs no I/O.
+ */
+static u_char *
+_asn_err(int err_class)
+{
+    asn_errors.Add(err_class);
+    return NULL;
+}
+
+uint64_t
+snmp_parse_error_count(int err_class)
+{
+    if (err_class < 0 || err_class >= ASN_ERR_CLASSES)
+        return 0;
+    return asn_errors.Read(err_class);
+}
+
+const char *
+snmp_parse_error_class_name(int err_class)
+{
+    static const char *const names[ASN_ERR_CLASSES] = {
+        "null", "short", "type", "length", "oid", "alloc", "version"
+    };
+
+    if (err_class < 0 || err_class >= ASN_ERR_CLASSES)
+        return "unknown";
+    return names[err_class];
+}
+
 u_char*
 asn_parse_length(u_char * data, u_long * length){
     static const char *errpre = "parse length";
@@ -107,36 +144,30 @@ asn_parse_int(u_char * data,
     } value;
 
     if (NULL == data || NULL == datalength || NULL == type || NULL == intp) {
-        //ERROR_MSG("parse int: NULL pointer");
-        return NULL;
+        return _asn_err(ASN_ERR_NULL);
     }
 
     if (intsize != sizeof(long)) {
-        //_asn_size_err(errpre, intsize, sizeof(long));
-        return NULL;
+        return _asn_err(ASN_ERR_LENGTH);
     }
 
     /** need at least 2 bytes to work with: type, length (which might be 0)  */
     if (*datalength < 2) {
-        //_asn_short_err(errpre, *datalength, 2);
-        return NULL;
+        return _asn_err(ASN_ERR_SHORT);
     }
 
     *type = *bufp++;
     if (*type != ASN_INTEGER) {
-        //_asn_type_err(errpre, *type);
-        return NULL;
+        return _asn_err(ASN_ERR_TYPE);
     }
 
     bufp = asn_parse_nlength(bufp, *datalength - 1, &asn_length);
     if (NULL == bufp) {
-        //_asn_short_err(errpre, *datalength - 1, asn_length);
-        return NULL;
+        return _asn_err(ASN_ERR_SHORT);
     }
 
     if ((size_t) asn_length > intsize || (int) asn_length == 0) {
-        //_asn_length_err(errpre, (size_t) asn_length, intsize);
-        return NULL;
+        return _asn_err(ASN_ERR_LENGTH);
     }
 
     *datalength -= (int) asn_length + (bufp - data);
@@ -165,14 +196,12 @@ asn_parse_header(u_char* data, size_t* datalength, u_char* type)
     //const char      *errpre = "parse header";
 
     if (!data || !datalength || !type) {
-        std::cout << "parse header: NULL pointer" << std::endl;
-        return NULL;
+        return _asn_err(ASN_ERR_NULL);
     }
 
     /** need at least 2 bytes to work with: type, length (which might be 0) */
     if (*datalength < 2) {
-        std::cout << "_asn_short_err(errpre, *datalength, 2" << std::endl;
-        return NULL;
+        return _asn_err(ASN_ERR_SHORT);
     }
 
     bufp = data;
@@ -180,15 +209,13 @@ asn_parse_header(u_char* data, size_t* datalength, u_char* type)
      * this only works on data types < 30, i.e. no extension octets
      */
     if (IS_EXTENSION_ID(*bufp)) {
-        std::cout << "can't process ID >= 30" << std::endl;
-        return NULL;
+        return _asn_err(ASN_ERR_TYPE);
     }
     *type = *bufp++;
 
     bufp = asn_parse_nlength(bufp, *datalength - 1, &asn_length);
     if (NULL == bufp) {
-        std::cout << "_asn_short_err(errpre, *datalength - 1, asn_length)" << std::endl;
-        return NULL;
+        return _asn_err(ASN_ERR_SHORT);
     }
 
     *datalength = (int) asn_length;
@@ -199,16 +226,10 @@ u_char*
 asn_parse_sequence(u_char * data, size_t * datalength, u_char* type, u_char expected_type,     /* must be this type */
                    const char *estr)
 {                               /* error message prefix */
+    (void) estr;                /* errors are counted by class, not printed */
     data = asn_parse_header(data, datalength, type);
     if (data && (*type != expected_type)) {
-        std::cout << "Unexpected type" << std::endl;
-        char            ebuf[128];
-        snprintf(ebuf, sizeof(ebuf),
-                 "%s header type %02X: s/b %02X", estr,
-                (u_char) * type, (u_char) expected_type);
-        ebuf[ sizeof(ebuf)-1 ] = 0;
-        //ERROR_MSG(ebuf);
-        return NULL;
+        return _asn_err(ASN_ERR_TYPE);
     }
     return data;
 }
@@ -223,31 +244,26 @@ asn_parse_string(u_char * data,
 
     if (NULL == data || NULL == datalength || NULL == type || NULL == str ||
         NULL == strlength) {
-        std::cout << "parse string: NULL pointer" << std::endl;
-        return NULL;
+        return _asn_err(ASN_ERR_NULL);
     }
 
     /** need at least 2 bytes to work with: type, length (which might be 0)  */
     if (*datalength < 2) {
-        std::cout << "parse string: datalength < 2" << std::endl;
-        return NULL;
+        return _asn_err(ASN_ERR_SHORT);
     }
 
     *type = *bufp++;
     if (*type != ASN_OCTET_STR && *type != ASN_IPADDRESS) {
-        std::cout << "parse string: error type" << std::endl;
-        return NULL;
+        return _asn_err(ASN_ERR_TYPE);
     }
 
     bufp = asn_parse_nlength(bufp, *datalength - 1, &asn_length);
     if (NULL == bufp) {
-        std::cout << "parse string: asn_parse_nlength" << std::endl;
-        return NULL;
+        return _asn_err(ASN_ERR_SHORT);
     }
 
     if (asn_length > *strlength) {
-        std::cout << "parse string: asn_length > *strlength" << std::endl;
-        return NULL;
+        return _asn_err(ASN_ERR_LENGTH);
     }
 
     memmove(str, bufp, asn_length);
@@ -283,7 +299,6 @@ snmp_comstr_parse(u_char * data,
     data = asn_parse_int(data, length, &type, &ver, sizeof(ver));
     *version = ver;
     if (data == NULL) {
-        std::cout << "bad parse of version" << std::endl;
         return NULL;
     }
 
@@ -292,7 +307,6 @@ snmp_comstr_parse(u_char * data,
      */
     data = asn_parse_string(data, length, &type, community, community_len);
     if (data == NULL) {
-        std::cout << "bad parse of community" << std::endl;
         return NULL;
     }
     community[SNMP_MIN(*community_len, origlen - 1)] = '\0';
@@ -319,25 +333,21 @@ asn_parse_objid(u_char * data,
     size_t          original_length = *objidlength;
 
     if (NULL == data || NULL == datalength || NULL == type || NULL == objid) {
-        std::cout << "parse objid: NULL pointer" << std::endl;
-        return NULL;
+        return _asn_err(ASN_ERR_NULL);
     }
 
     /** need at least 2 bytes to work with: type, length (which might be 0)  */
     if (*datalength < 2) {
-        std::cout << "parse objid: datalength < 2" << std::endl;
-        return NULL;
+        return _asn_err(ASN_ERR_SHORT);
     }
 
     *type = *bufp++;
     if (*type != ASN_OBJECT_ID) {
-        std::cout << "parse objid: wrong type" << std::endl;
-        return NULL;
+        return _asn_err(ASN_ERR_TYPE);
     }
     bufp = asn_parse_nlength(bufp, *datalength - 1, &asn_length);
     if (NULL == bufp) {
-        std::cout << "parse objid: *datalength - 1" << std::endl;
-        return NULL;
+        return _asn_err(ASN_ERR_SHORT);
     }
 
     *datalength -= (int) asn_length + (bufp - data);
@@ -363,21 +373,18 @@ asn_parse_objid(u_char * data,
             u_char *last_byte = bufp - 1;
             if (*last_byte & ASN_BIT8) {
                 /* last byte has high bit set -> wrong BER encoded OID */
-                std::cout << "subidentifier syntax error"<< std::endl;
-                return NULL;
+                return _asn_err(ASN_ERR_OID);
             }
         }
         if (subidentifier > MAX_SUBID) {
-            std::cout << "subidentifier too large"<< std::endl;
-            return NULL;
+            return _asn_err(ASN_ERR_OID);
         }
         *oidp++ = (oid) subidentifier;
     }
 
     if (length || oidp < objid + 1) {
-        std::cout << "OID length exceeds buffer size" << std::endl;
         *objidlength = original_length;
-        return NULL;
+        return _asn_err(ASN_ERR_OID);
     }
 
     /*
@@ -431,7 +438,6 @@ snmp_parse_var_op(u_char * data,
         asn_parse_objid(data, &var_op_len, &var_op_type, var_name,
                         var_name_len);
     if (data == NULL) {
-        std::cout << "No OID for variable" << std::endl;
         return NULL;
     }
     if (var_op_type !=
@@ -443,7 +449,6 @@ snmp_parse_var_op(u_char * data,
      */
     data = asn_parse_header(data, &var_op_len, var_val_type);
     if (data == NULL) {
-        std::cout << "No header for value" << std::endl;
         return NULL;
     }
     /*
@@ -455,6 +460,39 @@ snmp_parse_var_op(u_char * data,
     return data;
 }
 
+void
+snmp_free_var(netsnmp_variable_list * var)
+{
+    if (!var)
+        return;
+
+    if (var->name != var->name_loc)
+        SNMP_FREE(var->name);
+    if (var->val.string != var->buf)
+        SNMP_FREE(var->val.string);
+    if (var->data) {
+        if (var->dataFreeHook) {
+            var->dataFreeHook(var->data);
+            var->data = NULL;
+        } else {
+            SNMP_FREE(var->data);
+        }
+    }
+
+    free((char *) var);
+}
+
+void
+snmp_free_varbind(netsnmp_variable_list * var)
+{
+    netsnmp_variable_list *ptr;
+    while (var) {
+        ptr = var->next_variable;
+        snmp_free_var(var);
+        var = ptr;
+    }
+}
+
 int
 snmp_set_var_objid(netsnmp_variable_list * vp,
                    const oid * objid, size_t name_length){
@@ -498,36 +536,30 @@ u_char* asn_parse_unsigned_int64(u_char * data,
     u_long low = 0, high = 0;
 
     if (countersize != sizeof(struct counter64)) {
-        //_asn_size_err(errpre, countersize, sizeof(struct counter64));
-        return NULL;
+        return _asn_err(ASN_ERR_LENGTH);
     }
 
     if (NULL == data || NULL == datalength || NULL == type || NULL == cp) {
-        //ERROR_MSG("parse uint64: NULL pointer");
-        return NULL;
+        return _asn_err(ASN_ERR_NULL);
     }
 
     /** need at least 2 bytes to work with: type, length (which might be 0)  */
     if (*datalength < 2) {
-        //_asn_short_err(errpre, *datalength, 2);
-        return NULL;
+        return _asn_err(ASN_ERR_SHORT);
     }
 
     *type = *bufp++;
     if (*type != ASN_COUNTER64) {
-        //_asn_type_err(errpre, *type);
-        return NULL;
+        return _asn_err(ASN_ERR_TYPE);
     }
     bufp = asn_parse_nlength(bufp, *datalength - 1, &asn_length);
     if (NULL == bufp) {
-        //_asn_short_err(errpre, *datalength - 1, asn_length);
-        return NULL;
+        return _asn_err(ASN_ERR_SHORT);
     }
 
     if (((int) asn_length > uint64sizelimit) ||
         (((int) asn_length == uint64sizelimit) && *bufp != 0x00)) {
-        //_asn_length_err(errpre, (size_t) asn_length, uint64sizelimit);
-        return NULL;
+        return _asn_err(ASN_ERR_LENGTH);
     }
     *datalength -= (int) asn_length + (bufp - data);
     while (asn_length--) {
@@ -557,31 +589,26 @@ asn_parse_bitstring(u_char * data,
 
     if (NULL == data || NULL == datalength || NULL == type ||
         NULL == str || NULL == strlength) {
-        //ERROR_MSG("parse bitstring: NULL pointer");
-        return NULL;
+        return _asn_err(ASN_ERR_NULL);
     }
 
     /** need at least 2 bytes to work with: type, length (which might be 0)  */
     if (*datalength < 2) {
-        //_asn_short_err(errpre, *datalength, 2);
-        return NULL;
+        return _asn_err(ASN_ERR_SHORT);
     }
 
     *type = *bufp++;
     if (*type != ASN_BIT_STR) {
-        //_asn_type_err(errpre, *type);
-        return NULL;
+        return _asn_err(ASN_ERR_TYPE);
     }
 
     bufp = asn_parse_nlength(bufp, *datalength - 1, &asn_length);
     if (NULL == bufp) {
-        //_asn_short_err(errpre, *datalength - 1, asn_length);
-        return NULL;
+        return _asn_err(ASN_ERR_SHORT);
     }
 
     if ((size_t) asn_length > *strlength) {
-        //_asn_length_err(errpre, (size_t) asn_length, *strlength);
-        return NULL;
+        return _asn_err(ASN_ERR_LENGTH);
     }
     /*if (_asn_bitstring_check(errpre, asn_length, *bufp))
         return NULL;*/
@@ -592,38 +619,27 @@ asn_parse_bitstring(u_char * data,
     return bufp + asn_length;
 }
 
+/*
+ * request-id, error-status and error-index, the PDU fields before the
+ * variable-bindings.
+ */
+static bool
+read_preceding_fields(BerReader& reader, u_char& type, snmp_pdu* pdu)
+{
+    return reader.ReadInteger(type, pdu->reqid)
+           && reader.ReadInteger(type, pdu->errstat)
+           && reader.ReadInteger(type, pdu->errindex);
+}
+
 u_char* get_preceding_fields(u_char* data, size_t* length, u_char* type, snmp_pdu* pdu){
-    /*
-    * request id
-    */
-    data = asn_parse_int(data, length, type, &pdu->reqid,
-                                 sizeof(pdu->reqid));
-    if (data == NULL) {
-       std::cout << "wrong req id" << std::endl;
-       return NULL;
-    }
+    BerReader reader(std::span<const uint8_t>(data, *length));
 
-    /*
-    * error status (getbulk non-repeaters)
-    */
-    data = asn_parse_int(data, length, type, &pdu->errstat,
-                                 sizeof(pdu->errstat));
-    if (data == NULL) {
-      std::cout << "wrong error status" << std::endl;
-      return NULL;
+    if (!read_preceding_fields(reader, *type, pdu)) {
+        return _asn_err(reader.Error());
     }
-
-    /*
-    * error index (getbulk max-repetitions)
-    */
-
-     data = asn_parse_int(data, length, type, &pdu->errindex,
-                                 sizeof(pdu->errindex));
-     if (data == NULL) {
-       return NULL;
-     }
-
-     return (u_char *) data;
+    data += *length - reader.Remaining();
+    *length = reader.Remaining();
+    return data;
 }
 
 /**
@@ -682,39 +698,33 @@ asn_parse_unsigned_int(u_char * data,
     u_long value = 0;
 
     if (NULL == data || NULL == datalength || NULL == type || NULL == intp) {
-        //ERROR_MSG("parse uint: NULL pointer");
-        return NULL;
+        return _asn_err(ASN_ERR_NULL);
     }
 
     if (intsize != sizeof(long)) {
-        //_asn_size_err(errpre, intsize, sizeof(long));
-        return NULL;
+        return _asn_err(ASN_ERR_LENGTH);
     }
 
     /** need at least 2 bytes to work with: type, length (which might be 0)  */
     if (*datalength < 2) {
-        //_asn_short_err(errpre, *datalength, 2);
-        return NULL;
+        return _asn_err(ASN_ERR_SHORT);
     }
 
     *type = *bufp++;
     if (*type != ASN_COUNTER && *type != ASN_GAUGE && *type != ASN_TIMETICKS
         //&& *type != ASN_UINTEGER) {
             ){
-        //_asn_type_err(errpre, *type);
-        return NULL;
+        return _asn_err(ASN_ERR_TYPE);
     }
 
     bufp = asn_parse_nlength(bufp, *datalength - 1, &asn_length);
     if (NULL == bufp) {
-        //_asn_short_err(errpre, *datalength - 1, asn_length);
-        return NULL;
+        return _asn_err(ASN_ERR_SHORT);
     }
 
     if ((asn_length > (intsize + 1)) || ((int) asn_length == 0) ||
         ((asn_length == intsize + 1) && *bufp != 0x00)) {
-        //_asn_length_err(errpre, (size_t) asn_length, intsize);
-        return NULL;
+        return _asn_err(ASN_ERR_LENGTH);
     }
     *datalength -= (int) asn_length + (bufp - data);
 
@@ -733,47 +743,55 @@ asn_parse_unsigned_int(u_char * data,
 }
 
 
-void get_var_bind_sequences(u_char* data, size_t* length, snmp_pdu* pdu){
-    size_t          len;
-    u_char         *p;
+/*
+ * Decodes the varBind sequences left in list onto pdu->variables.
+ */
+static int
+read_var_binds(VarBindReader& list, snmp_pdu* pdu)
+{
     netsnmp_variable_list* vp = NULL, *vplast = NULL;
     oid             objid[MAX_OID_LEN];
-    u_char* var_val;
-    if (data == NULL){
-        //goto fail;
-        std::cout << "null data" << std::endl;
-    }
+    int             err = SNMPERR_BAD_PARSE;
+    VarBindView     vb;
+
     /*
     * get each varBind sequence
     */
-    while ((int) *length > 0) {
+    while (list.Next(vb)) {
+      BerReader name(vb.name);
+      BerReader value(vb.value);
+      std::span<const uint8_t> contents;
+      u_char type;
+
       vp = SNMP_MALLOC_TYPEDEF(netsnmp_variable_list);
       if (NULL == vp){
-          //goto fail;
-          std::cout << "no vp" << std::endl;
+          _asn_err(ASN_ERR_ALLOC);
+          err = SNMPERR_MALLOC;
+          goto fail;
       }
 
       vp->name_length = MAX_OID_LEN;
-      data = snmp_parse_var_op(data, objid, &vp->name_length, &vp->type,
-                                     &vp->val_len, &var_val, length);
-      if (data == NULL){
-        std::cout << "data is null" << std::endl;
-         goto fail;
+      if (!name.ReadObjid(type, objid, vp->name_length)) {
+          _asn_err(name.Error());
+          goto fail;
       }
+      vp->type = vb.type;
+      vp->val_len = vb.contents.size();
+
       if (snmp_set_var_objid(vp, objid, vp->name_length)){
+        _asn_err(ASN_ERR_ALLOC);
+        err = SNMPERR_MALLOC;
         goto fail;
       }
 
-      len = SNMP_MAX_PACKET_LEN;
       switch ((short) vp->type) {
           case ASN_INTEGER:
               vp->val.integer = (long *) vp->buf;
               vp->val_len = sizeof(long);
-              p = asn_parse_int(var_val, &len, &vp->type,
-                                (long *) vp->val.integer,
-                                sizeof(*vp->val.integer));
-              if (!p)
+              if (!value.ReadInteger(vp->type, *vp->val.integer)) {
+                  _asn_err(value.Error());
                   goto fail;
+              }
               break;
           case ASN_COUNTER:
           case ASN_GAUGE:
@@ -781,53 +799,60 @@ void get_var_bind_sequences(u_char* data, size_t* length, snmp_pdu* pdu){
           case ASN_UINTEGER:
               vp->val.integer = (long *) vp->buf;
               vp->val_len = sizeof(u_long);
-              p = asn_parse_unsigned_int(var_val, &len, &vp->type,
-                                         (u_long *) vp->val.integer,
-                                         vp->val_len);
-              if (!p)
+              if (!value.ReadUnsigned(vp->type, *(u_long *) vp->val.integer)) {
+                  _asn_err(value.Error());
                   goto fail;
+              }
               break;
 
           case ASN_COUNTER64:
               vp->val.counter64 = (struct counter64 *) vp->buf;
               vp->val_len = sizeof(struct counter64);
-              p = asn_parse_unsigned_int64(var_val, &len, &vp->type,
-                                           (struct counter64 *) vp->val.
-                                                   counter64, vp->val_len);
-              if (!p)
+              if (!value.ReadCounter64(vp->type, *vp->val.counter64)) {
+                  _asn_err(value.Error());
                   goto fail;
+              }
               break;
 
 
           case ASN_IPADDRESS:
-              if (vp->val_len != 4)
+              if (vp->val_len != 4) {
+                  _asn_err(ASN_ERR_LENGTH);
                   goto fail;
+              }
               /* fallthrough */
           case ASN_OCTET_STR:
           case ASN_OPAQUE:
           case ASN_NSAP:
+              if (!value.ReadString(vp->type, contents)) {
+                  _asn_err(value.Error());
+                  goto fail;
+              }
               if (vp->val_len < sizeof(vp->buf)) {
                   vp->val.string = (u_char *) vp->buf;
               } else {
                   vp->val.string = (u_char *) malloc(vp->val_len);
               }
               if (vp->val.string == NULL) {
+                  _asn_err(ASN_ERR_ALLOC);
+                  err = SNMPERR_MALLOC;
                   goto fail;
               }
-              p = asn_parse_string(var_val, &len, &vp->type, vp->val.string,
-                                   &vp->val_len);
-              if (!p)
-                  goto fail;
+              memcpy(vp->val.string, contents.data(), vp->val_len);
               break;
           case ASN_OBJECT_ID:
               vp->val_len = MAX_OID_LEN;
-              p = asn_parse_objid(var_val, &len, &vp->type, objid, &vp->val_len);
-              if (!p)
+              if (!value.ReadObjid(vp->type, objid, vp->val_len)) {
+                  _asn_err(value.Error());
                   goto fail;
+              }
               vp->val_len *= sizeof(oid);
               vp->val.objid = (oid*) netsnmp_memdup(objid, vp->val_len);
-              if (vp->val.objid == NULL)
+              if (vp->val.objid == NULL) {
+                  _asn_err(ASN_ERR_ALLOC);
+                  err = SNMPERR_MALLOC;
                   goto fail;
+              }
               break;
           case SNMP_NOSUCHOBJECT:
           case SNMP_NOSUCHINSTANCE:
@@ -835,21 +860,24 @@ void get_var_bind_sequences(u_char* data, size_t* length, snmp_pdu* pdu){
           case ASN_NULL:
               break;
           case ASN_BIT_STR:
+              if (!value.ReadBitString(vp->type, contents)) {
+                  _asn_err(value.Error());
+                  goto fail;
+              }
               vp->val.bitstring = (u_char *) malloc(vp->val_len);
               if (vp->val.bitstring == NULL) {
+                  _asn_err(ASN_ERR_ALLOC);
+                  err = SNMPERR_MALLOC;
                   goto fail;
               }
-              p = asn_parse_bitstring(var_val, &len, &vp->type,
-                                      vp->val.bitstring, &vp->val_len);
-              if (!p)
-                  goto fail;
+              memcpy(vp->val.bitstring, contents.data(), vp->val_len);
               break;
           default:
-              //snmp_log(LOG_ERR, "bad type returned (%x)\n", vp->type);
+              _asn_err(ASN_ERR_TYPE);
               goto fail;
               break;
       }
-        //DEBUGINDENTADD(-4);
+        SNMP_PROBE2(varbind_decoded, vp->type, vp->name_length);
 
         if (NULL == vplast) {
             pdu->variables = vp;
@@ -859,66 +887,90 @@ void get_var_bind_sequences(u_char* data, size_t* length, snmp_pdu* pdu){
         vplast = vp;
         vp = NULL;
     }
-    //return 0;
+    if (list.Error() >= 0) {
+        _asn_err(list.Error());
+        return SNMPERR_BAD_PARSE;
+    }
+    return SNMPERR_SUCCESS;
 
     fail:
-    {
-        //const char *errstr = snmp_api_errstring(SNMPERR_SUCCESS);
-        //DEBUGMSGTL(("recv", "error while parsing VarBindList:%s\n", errstr));
-    }
     /** if we were parsing a var, remove it from the pdu and free it */
     if (vp) {
-        //snmp_free_var(vp);
+        snmp_free_var(vp);
     }
-
-   // return -1;
+    return err;
 }
 
-/*
- * Parses the packet received to determine version, either directly
- * from packets version field or inferred from ASN.1 construct.
- */
-static int
-snmp_parse_version(u_char * data, size_t length)
-{
-    u_char          type;
-    long            version = SNMPERR_BAD_VERSION;
-
-    data = asn_parse_sequence(data, &length, &type,
-                              (ASN_SEQUENCE | ASN_CONSTRUCTOR), "version");
-    if (data) {
-        data =
-                asn_parse_int(data, &length, &type, &version, sizeof(version));
-        if (!data || type != ASN_INTEGER) {
-            return SNMPERR_BAD_VERSION;
-        }
+int get_var_bind_sequences(u_char* data, size_t* length, snmp_pdu* pdu){
+    if (data == NULL){
+        return SNMPERR_BAD_PARSE;
     }
-    return version;
+    VarBindReader list(std::span<const uint8_t>(data, *length));
+    int rc = read_var_binds(list, pdu);
+    *length = list.Remaining();
+    return rc;
+}
+
+int parse_var_binds(std::span<const uint8_t> varbinds, snmp_pdu* pdu){
+    VarBindReader list(varbinds);
+    return read_var_binds(list, pdu);
 }
 
-bool parse_pdu(u_char* data, size_t* length, snmp_pdu* pdu){
+int parse_pdu_header(u_char* data, size_t length, snmp_pdu* pdu, std::span<const uint8_t>* varbinds,
+                     CommunityAllowlist* communities){
+    BerReader message(std::span<const uint8_t>(data, length));
+    std::span<const uint8_t> community;
+    u_char          msg_type;
+    u_char          type;
 
-    pdu->version = snmp_parse_version(data, *length);
+    /*
+     * Message ::= SEQUENCE { version INTEGER, community OCTET STRING, data PDU }
+     */
+    if (!message.EnterSequence(ASN_SEQUENCE | ASN_CONSTRUCTOR)
+        || !message.ReadInteger(type, pdu->version)) {
+        _asn_err(message.Error());
+        pdu->version = SNMPERR_BAD_VERSION;
+        return SNMPERR_BAD_VERSION;
+    }
     if(SNMP_VERSION_2c != pdu->version){
-        return false;
+        _asn_err(ASN_ERR_VERSION);
+        return SNMPERR_BAD_VERSION;
+    }
+
+    if (!message.ReadString(type, community)) {
+        _asn_err(message.Error());
+        return SNMPERR_BAD_COMMUNITY;
+    }
+    if (community.size() > COMMUNITY_MAX_LEN) {
+        _asn_err(ASN_ERR_LENGTH);
+        return SNMPERR_BAD_COMMUNITY;
+    }
+    if (communities && !communities->Accept(community)) {
+        return SNMPERR_AUTHENTICATION_FAILURE;
     }
-    size_t community_length = COMMUNITY_MAX_LEN;
-    u_char *community = new u_char[COMMUNITY_MAX_LEN];
-    data = snmp_comstr_parse(data, length,
-                             community, &community_length,
-                             &pdu->version);
-    u_char          msg_type; //todo check memory
-    u_char          type;   //todo check memory
 
     /* get msg type (here we parse type trap v2) */
-    data = asn_parse_header(data, length, &msg_type);
+    if (!message.Enter(msg_type)
+        || !read_preceding_fields(message, type, pdu)
+        || !message.EnterSequence(ASN_SEQUENCE | ASN_CONSTRUCTOR)) {
+        _asn_err(message.Error());
+        return SNMPERR_BAD_PARSE;
+    }
 
-    data = get_preceding_fields(data, length, &type, pdu);
-    data = asn_parse_sequence(data, length, &type,
-                              (ASN_SEQUENCE | ASN_CONSTRUCTOR),
-                              "varbinds");
+    *varbinds = message.Data();
+    return SNMPERR_SUCCESS;
+}
 
-    get_var_bind_sequences(data, length, pdu);
-    delete[] community;
-    return true;
-}
\ No newline at end of file
+int parse_pdu(u_char* data, size_t* length, snmp_pdu* pdu){
+    std::span<const uint8_t> varbinds;
+
+    int rc = parse_pdu_header(data, *length, pdu, &varbinds);
+    if (rc != SNMPERR_SUCCESS) {
+        return rc;
+    }
+
+    VarBindReader list(varbinds);
+    rc = read_var_binds(list, pdu);
+    *length = list.Remaining();
+    return rc;
+}
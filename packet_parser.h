@@ -2,10 +2,13 @@
 #define PARSE_PACKET_H
 
 #include <sys/types.h>
+#include <cstdint>
+#include <span>
 
 #include "shared_constants.h"
 #include "snmp_pdu.h"
 
+class CommunityAllowlist;
 
 #define SNMP_VERSION_1	   0
 #define SNMP_VERSION_2c    1
@@ -16,7 +19,37 @@
 /*
 * Error return values.
 */
+#define SNMPERR_SUCCESS			(0)
+#define SNMPERR_BAD_PARSE		(-13)
 #define SNMPERR_BAD_VERSION		(-14)
+#define SNMPERR_BAD_COMMUNITY		(-18)
+#define SNMPERR_AUTHENTICATION_FAILURE	(-35)
+#define SNMPERR_MALLOC			(-62)
+
+/*
+ * Classes of decoding errors, each counted where it is detected.
+ */
+#define ASN_ERR_NULL        0   /* NULL pointer argument */
+#define ASN_ERR_SHORT       1   /* data ends before its encoding says */
+#define ASN_ERR_TYPE        2   /* unexpected or unsupported ASN.1 type */
+#define ASN_ERR_LENGTH      3   /* length out of range for the type */
+#define ASN_ERR_OID         4   /* malformed OBJECT IDENTIFIER */
+#define ASN_ERR_ALLOC       5   /* out of memory */
+#define ASN_ERR_VERSION     6   /* well-formed, but not SNMPv2c */
+#define ASN_ERR_CLASSES     7
+
+/**
+ * Number of decoding errors of class err_class (ASN_ERR_*) so far, over
+ * all threads.
+ */
+uint64_t
+snmp_parse_error_count(int err_class);
+
+/**
+ * Short name of an ASN_ERR_* class, e.g. "short".
+ */
+const char *
+snmp_parse_error_class_name(int err_class);
 
 
 
@@ -232,6 +265,18 @@ snmp_parse_var_op(u_char * data,
                   size_t * var_val_len,
                   u_char ** var_val, size_t * listlength);
 
+/*
+ * Frees a variable, including the name and value buffers it allocated.
+ */
+void
+snmp_free_var(netsnmp_variable_list * var);
+
+/*
+ * Frees a list of variables, as hung off snmp_pdu::variables.
+ */
+void
+snmp_free_varbind(netsnmp_variable_list * var);
+
 /*
  * Add object identifier name to SNMP variable.
  * If the name is large, additional memory is allocated.
@@ -302,9 +347,42 @@ asn_parse_bitstring(u_char * data,
 */
 u_char* get_preceding_fields(u_char* data, size_t* length, u_char* type, snmp_pdu* pdu);
 
-void get_var_bind_sequences(u_char* data, size_t* length, snmp_pdu* pdu);
+/**
+* parse the variable-bindings sequence into pdu->variables
+*
+* @return SNMPERR_SUCCESS, or SNMPERR_BAD_PARSE / SNMPERR_MALLOC; the
+*         variables parsed before the error are kept in pdu
+*/
+int get_var_bind_sequences(u_char* data, size_t* length, snmp_pdu* pdu);
+
+/**
+* parse an SNMPv2c message up to its variable-bindings: version, request
+* id and error fields go into pdu, and varbinds is set to the contents of
+* the variable-bindings sequence, for a VarBindReader to walk
+*
+* With communities, a message whose community is not in it is rejected
+* with SNMPERR_AUTHENTICATION_FAILURE before the PDU is looked at.
+*
+* @return SNMPERR_SUCCESS or one of the SNMPERR_* codes above
+*/
+int parse_pdu_header(u_char* data, size_t length, snmp_pdu* pdu, std::span<const uint8_t>* varbinds,
+                     CommunityAllowlist* communities = nullptr);
+
+/**
+* parse the contents of a variable-bindings sequence, as returned by
+* parse_pdu_header(), into pdu->variables
+*
+* @return as get_var_bind_sequences()
+*/
+int parse_var_binds(std::span<const uint8_t> varbinds, snmp_pdu* pdu);
 
-bool parse_pdu(u_char* data, size_t* length, snmp_pdu* pdu);
+/**
+* parse an SNMPv2c message into pdu; once the header is parsed, *length
+* is set to what is left of the variable-bindings, 0 if all were decoded
+*
+* @return SNMPERR_SUCCESS or one of the SNMPERR_* codes above
+*/
+int parse_pdu(u_char* data, size_t* length, snmp_pdu* pdu);
 
 #endif // PARSE_PACKET_H
 
@@ -0,0 +1,133 @@
+#include "receive_buffer.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <sys/socket.h>
+#include <sys/stat.h>
+
+#include <linux/sock_diag.h>
+
+int ReceiveBuffer::Apply( int fd, size_t size, size_t max_size, bool filtered ) {
+    m_Fd         = fd;
+    m_MaxSize    = max_size;
+    m_Filtered   = filtered;
+    m_Growths    = 0;
+    m_Drops      = 0;
+    m_LastGrowth = {};
+    int error    = size ? setSize( size ) : 0;
+
+    /* best effort: without it the drops are only seen through GetSocketDrops */
+    int on = 1;
+    setsockopt( fd, SOL_SOCKET, SO_RXQ_OVFL, &on, sizeof( on ) );
+    readSize();
+    /* SO_RCVBUF reports twice what was set, the kernel's allowance for overhead */
+    m_Requested = size ? size : m_Size / 2;
+    return error;
+}
+
+void ReceiveBuffer::readSize() {
+    int       actual = 0;
+    socklen_t len    = sizeof( actual );
+    if ( getsockopt( m_Fd, SOL_SOCKET, SO_RCVBUF, &actual, &len ) == 0 ) {
+        m_Size = actual;
+    }
+}
+
+/*
+ * SO_RCVBUFFORCE goes past net.core.rmem_max but needs CAP_NET_ADMIN;
+ * without it SO_RCVBUF is used, capped at rmem_max.
+ */
+int ReceiveBuffer::setSize( size_t size ) {
+    int value = size > INT32_MAX / 2 ? INT32_MAX / 2 : (int) size;
+    if ( setsockopt( m_Fd, SOL_SOCKET, SO_RCVBUFFORCE, &value, sizeof( value ) ) == 0
+         || setsockopt( m_Fd, SOL_SOCKET, SO_RCVBUF, &value, sizeof( value ) ) == 0 ) {
+        return 0;
+    }
+    return errno;
+}
+
+bool ReceiveBuffer::queueHalfFull() const {
+    uint32_t  meminfo[SK_MEMINFO_VARS];
+    socklen_t len = sizeof( meminfo );
+    if ( getsockopt( m_Fd, SOL_SOCKET, SO_MEMINFO, meminfo, &len ) < 0 || len <= SK_MEMINFO_RCVBUF * sizeof( uint32_t ) ) {
+        return true; /* cannot tell, so trust the drops */
+    }
+    return meminfo[SK_MEMINFO_RMEM_ALLOC] >= meminfo[SK_MEMINFO_RCVBUF] / 2;
+}
+
+void ReceiveBuffer::OnDrops( uint32_t drops ) {
+    if ( drops == m_Drops ) {
+        return;
+    }
+    m_Drops = drops;
+    if ( m_Requested >= m_MaxSize ) {
+        return;
+    }
+    auto now = std::chrono::steady_clock::now();
+    if ( now - m_LastGrowth < std::chrono::seconds( 1 ) || ( m_Filtered && !queueHalfFull() ) ) {
+        return;
+    }
+    m_LastGrowth = now;
+
+    size_t before = m_Size;
+    size_t size   = m_Requested * 2 < m_MaxSize ? m_Requested * 2 : m_MaxSize;
+    if ( setSize( size ) == 0 ) {
+        readSize();
+    }
+    if ( m_Size > before ) {
+        m_Requested = size;
+        m_Growths++;
+    } else {
+        m_MaxSize = m_Requested; /* capped by rmem_max, no use trying again */
+    }
+}
+
+namespace {
+    /* The drops column of the socket with this inode in a /proc/net/udp style table. */
+    bool read_proc_drops( const char *path, unsigned long inode, uint32_t *drops ) {
+        FILE *f = fopen( path, "r" );
+        if ( !f ) {
+            return false;
+        }
+        char line[512];
+        bool found = false;
+        if ( fgets( line, sizeof( line ), f ) ) { /* header */
+            while ( !found && fgets( line, sizeof( line ), f ) ) {
+                unsigned long line_inode;
+                unsigned      line_drops;
+                /* sl local rem st tx:rx tr:tm retrnsmt uid timeout inode ref pointer drops */
+                if ( sscanf( line, "%*s %*s %*s %*s %*s %*s %*s %*s %*s %lu %*s %*s %u", &line_inode, &line_drops ) == 2
+                     && line_inode == inode ) {
+                    *drops = line_drops;
+                    found  = true;
+                }
+            }
+        }
+        fclose( f );
+        return found;
+    }
+} // namespace
+
+bool GetSocketDrops( int fd, uint32_t *drops ) {
+    uint32_t  meminfo[SK_MEMINFO_VARS];
+    socklen_t len = sizeof( meminfo );
+    if ( getsockopt( fd, SOL_SOCKET, SO_MEMINFO, meminfo, &len ) == 0 && len > SK_MEMINFO_DROPS * sizeof( uint32_t ) ) {
+        *drops = meminfo[SK_MEMINFO_DROPS];
+        return true;
+    }
+    struct stat st;
+    if ( fstat( fd, &st ) < 0 ) {
+        return false;
+    }
+    return read_proc_drops( "/proc/net/udp", st.st_ino, drops ) || read_proc_drops( "/proc/net/udp6", st.st_ino, drops );
+}
+
+bool GetSocketQueued( int fd, uint32_t *bytes ) {
+    uint32_t  meminfo[SK_MEMINFO_VARS];
+    socklen_t len = sizeof( meminfo );
+    if ( getsockopt( fd, SOL_SOCKET, SO_MEMINFO, meminfo, &len ) < 0 || len <= SK_MEMINFO_RMEM_ALLOC * sizeof( uint32_t ) ) {
+        return false;
+    }
+    *bytes = meminfo[SK_MEMINFO_RMEM_ALLOC];
+    return true;
+}
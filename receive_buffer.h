@@ -0,0 +1,68 @@
+#ifndef SNMP_SHARED_LIB_RECEIVE_BUFFER_H
+#define SNMP_SHARED_LIB_RECEIVE_BUFFER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * The receive buffer of the trap socket: sized from config, asked to
+ * report the kernel's drop count with every datagram (SO_RXQ_OVFL), and
+ * grown while datagrams are dropped for want of room.
+ *
+ * The drop count also covers datagrams a socket filter rejected, so with
+ * a filter attached a rise only grows the buffer when the queue is at
+ * least half full.
+ */
+class ReceiveBuffer {
+public:
+    /**
+     * Sets up fd.  size 0 keeps the kernel default; a max_size above it
+     * lets the buffer double, at most once a second, up to max_size.
+     * Sizes are as given to SO_RCVBUF.  filtered tells that a socket
+     * filter drops datagrams too.  Returns 0 or the errno of a failed
+     * sizing.
+     */
+    int Apply( int fd, size_t size, size_t max_size, bool filtered );
+
+    /** Notes the drop count a received datagram carried. */
+    void OnDrops( uint32_t drops );
+
+    /** Bytes the kernel allows the queue, as SO_RCVBUF reports it. */
+    size_t GetSize() const { return m_Size; }
+
+    /** Times the buffer was grown. */
+    uint64_t GetGrowths() const { return m_Growths; }
+
+private:
+    int  setSize( size_t size );
+    void readSize();
+    bool queueHalfFull() const;
+
+    int                                   m_Fd        = -1;
+    size_t                                m_MaxSize   = 0;
+    size_t                                m_Requested = 0; // last size set, before the kernel doubles it
+    bool                                  m_Filtered  = false;
+    std::atomic<size_t>                   m_Size{ 0 };
+    std::atomic<uint64_t>                 m_Growths{ 0 };
+    uint32_t                              m_Drops     = 0;
+    std::chrono::steady_clock::time_point m_LastGrowth;
+};
+
+/*
+ * Datagrams the kernel dropped on this socket since it was opened: those
+ * a filter rejected plus any that found the receive buffer full.  Read
+ * from SO_MEMINFO, or sampled from /proc/net/udp on kernels without it.
+ * Returns false if neither can tell.
+ */
+bool GetSocketDrops( int fd, uint32_t *drops );
+
+/*
+ * Bytes of datagrams waiting in the socket's receive queue, counted as
+ * the kernel charges them against the receive buffer.  Returns false
+ * without SO_MEMINFO.
+ */
+bool GetSocketQueued( int fd, uint32_t *bytes );
+
+#endif // SNMP_SHARED_LIB_RECEIVE_BUFFER_H
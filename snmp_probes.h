@@ -0,0 +1,36 @@
+#ifndef SNMP_SHARED_LIB_SNMP_PROBES_H
+#define SNMP_SHARED_LIB_SNMP_PROBES_H
+
+/*
+ * USDT tracepoints of provider snmp_trap, for bpftrace or perf to attach
+ * to in a running collector, e.g.
+ *
+ *   bpftrace -e 'usdt:libTrapDataProvider.so:snmp_trap:parse_end { @rc[arg0] = count(); }'
+ *
+ * A probe is a single nop until a tracer enables it, and its arguments
+ * are values already at hand, so they cost next to nothing when unused.
+ * Without <sys/sdt.h> they compile to nothing at all.
+ *
+ *   datagram_received(bytes)
+ *   parse_start(bytes)             parse_end(rc, decoded)
+ *   varbind_decoded(type, name_len)
+ *   symbol_lookup(name_len)        symbol_hit(unresolved, peers)
+ *                                  for each OID rendered against the MIB
+ *                                  tree: the subids left below the deepest
+ *                                  node found (the hit depth is name_len -
+ *                                  unresolved) and the peers scanned there
+ *   format_end(bytes)
+ *   sink_write(sink, traps, bytes) sink is "tap", "listener" or "columnar"
+ */
+#if defined(__has_include) && __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define SNMP_PROBE1(name, a)       DTRACE_PROBE1(snmp_trap, name, a)
+#define SNMP_PROBE2(name, a, b)    DTRACE_PROBE2(snmp_trap, name, a, b)
+#define SNMP_PROBE3(name, a, b, c) DTRACE_PROBE3(snmp_trap, name, a, b, c)
+#else
+#define SNMP_PROBE1(name, a)       do { (void) sizeof(a); } while (0)
+#define SNMP_PROBE2(name, a, b)    do { (void) sizeof(a); (void) sizeof(b); } while (0)
+#define SNMP_PROBE3(name, a, b, c) do { (void) sizeof(a); (void) sizeof(b); (void) sizeof(c); } while (0)
+#endif
+
+#endif //SNMP_SHARED_LIB_SNMP_PROBES_H
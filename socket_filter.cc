@@ -0,0 +1,129 @@
+#include "socket_filter.h"
+
+#include <cerrno>
+#include <cstring>
+#include <sys/socket.h>
+
+namespace {
+    /* A UDP socket filter sees the datagram from the UDP header on. */
+    constexpr uint32_t PAYLOAD = 8;
+
+    constexpr uint32_t KEEP_ALL = 0xFFFFFFFF;
+
+    /* longest community whose length fits the short form */
+    constexpr size_t MAX_PREFIX = 127;
+
+    /* Branch targets still to be set to the drop instruction. */
+    enum Branch { TRUE_DROPS, FALSE_DROPS };
+
+    struct Program {
+        std::vector<sock_filter>              insns;
+        std::vector<std::pair<size_t, Branch>> to_drop;
+
+        void stmt(uint16_t code, uint32_t k) { insns.push_back(BPF_STMT(code, k)); }
+
+        /* a conditional jump on A that drops on one branch and falls through on the other */
+        void check(uint16_t code, uint32_t k, Branch drops) {
+            to_drop.emplace_back(insns.size(), drops);
+            insns.push_back(BPF_JUMP(BPF_JMP | code | BPF_K, k, 0, 0));
+        }
+
+        std::vector<sock_filter> finish() {
+            stmt(BPF_RET | BPF_K, KEEP_ALL);
+            size_t drop = insns.size();
+            stmt(BPF_RET | BPF_K, 0);
+            for (const auto& [at, branch] : to_drop) {
+                uint8_t offset = (uint8_t) (drop - at - 1);
+                if (branch == TRUE_DROPS) {
+                    insns[at].jt = offset;
+                } else {
+                    insns[at].jf = offset;
+                }
+            }
+            return std::move(insns);
+        }
+    };
+}
+
+std::vector<sock_filter> BuildTrapSocketFilter(std::string_view community_prefix) {
+    if (community_prefix.size() > MAX_PREFIX) {
+        return {};
+    }
+    Program p;
+
+    /* Message ::= SEQUENCE */
+    p.stmt(BPF_LD | BPF_B | BPF_ABS, PAYLOAD);
+    p.check(BPF_JEQ, 0x30, FALSE_DROPS);
+
+    /* X = offset of the version: past a short length, or past 1 to 4 length octets */
+    p.stmt(BPF_LD | BPF_B | BPF_ABS, PAYLOAD + 1);
+    p.insns.push_back(BPF_JUMP(BPF_JMP | BPF_JSET | BPF_K, 0x80, 0, 6));
+    p.stmt(BPF_ALU | BPF_AND | BPF_K, 0x7F);
+    p.stmt(BPF_ALU | BPF_SUB | BPF_K, 1);
+    p.check(BPF_JGT, 3, TRUE_DROPS); /* also 0x80, which wraps */
+    p.stmt(BPF_ALU | BPF_ADD | BPF_K, PAYLOAD + 3);
+    p.stmt(BPF_MISC | BPF_TAX, 0);
+    p.insns.push_back(BPF_JUMP(BPF_JMP | BPF_JA, 1, 0, 0));
+    p.stmt(BPF_LDX | BPF_W | BPF_IMM, PAYLOAD + 2);
+
+    /* version INTEGER 1 (v2c), then the community's OCTET STRING tag */
+    p.stmt(BPF_LD | BPF_W | BPF_IND, 0);
+    p.check(BPF_JEQ, 0x02010104, FALSE_DROPS);
+
+    if (!community_prefix.empty()) {
+        p.stmt(BPF_LD | BPF_B | BPF_IND, 4);
+        p.check(BPF_JSET, 0x80, TRUE_DROPS);
+        p.check(BPF_JGE, (uint32_t) community_prefix.size(), FALSE_DROPS);
+
+        /* compared a word at a time; loads are big-endian */
+        size_t i = 0;
+        while (i < community_prefix.size()) {
+            size_t   n = community_prefix.size() - i >= 4 ? 4 : community_prefix.size() - i >= 2 ? 2 : 1;
+            uint32_t value = 0;
+            for (size_t j = 0; j < n; j++) {
+                value = (value << 8) | (uint8_t) community_prefix[i + j];
+            }
+            p.stmt(BPF_LD | (n == 4 ? BPF_W : n == 2 ? BPF_H : BPF_B) | BPF_IND, (uint32_t) (5 + i));
+            p.check(BPF_JEQ, value, FALSE_DROPS);
+            i += n;
+        }
+    }
+    return p.finish();
+}
+
+/* The checks of the program in the same order; a load past the end drops, as it does there. */
+bool TrapSocketFilterAccepts(const uint8_t* data, size_t len, std::string_view community_prefix) {
+    if (len < 2 || data[0] != 0x30) {
+        return false;
+    }
+    size_t version = 2;
+    if (data[1] & 0x80) {
+        size_t octets = data[1] & 0x7F;
+        if (octets == 0 || octets > 4) {
+            return false;
+        }
+        version += octets;
+    }
+    if (len < version + 4 || memcmp(data + version, "\x02\x01\x01\x04", 4) != 0) {
+        return false;
+    }
+    if (community_prefix.empty()) {
+        return true;
+    }
+    size_t community = version + 5;
+    if (len < community || (data[community - 1] & 0x80) || data[community - 1] < community_prefix.size()) {
+        return false;
+    }
+    return len >= community + community_prefix.size()
+           && memcmp(data + community, community_prefix.data(), community_prefix.size()) == 0;
+}
+
+int AttachSocketFilter(int fd, const std::vector<sock_filter>& program) {
+    sock_fprog fprog;
+    fprog.len    = (unsigned short) program.size();
+    fprog.filter = const_cast<sock_filter*>(program.data());
+    if (setsockopt(fd, SOL_SOCKET, SO_ATTACH_FILTER, &fprog, sizeof(fprog)) < 0) {
+        return errno;
+    }
+    return 0;
+}
@@ -0,0 +1,38 @@
+#ifndef SNMP_SHARED_LIB_SOCKET_FILTER_H
+#define SNMP_SHARED_LIB_SOCKET_FILTER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include <linux/filter.h>
+
+/*
+ * Classic BPF program for a UDP socket that only lets SNMPv2c messages
+ * through: a SEQUENCE with a short or 1 to 4 byte long form length,
+ * followed by the version INTEGER 02 01 01 and the community OCTET STRING.
+ * With a community_prefix the community must also start with it.
+ * Anything else is dropped by the kernel before it is queued.
+ *
+ * Only the minimal encodings every agent sends are matched, so a message
+ * the parser would accept with a padded version may be dropped.  Returns
+ * an empty program if the prefix is longer than a short form community.
+ */
+std::vector<sock_filter> BuildTrapSocketFilter(std::string_view community_prefix);
+
+/*
+ * Whether the program built for community_prefix lets the UDP payload
+ * data through.  The kernel runs a socket filter once per skb, so with
+ * UDP_GRO it only sees the first of the datagrams coalesced into one;
+ * the others are checked with this.
+ */
+bool TrapSocketFilterAccepts(const uint8_t* data, size_t len, std::string_view community_prefix);
+
+/*
+ * Attaches program to the socket with SO_ATTACH_FILTER, which needs no
+ * privileges.  Returns 0 or the errno of the failure.
+ */
+int AttachSocketFilter(int fd, const std::vector<sock_filter>& program);
+
+#endif //SNMP_SHARED_LIB_SOCKET_FILTER_H
@@ -0,0 +1,266 @@
+#include "string_kernels.h"
+
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define STRING_KERNELS_X86 1
+#endif
+
+namespace {
+
+const char hex_digits[] = "0123456789ABCDEF";
+
+inline int
+is_printable_octet(u_char ch) {
+    return (u_char) (ch - 0x20) <= 0x5E || (u_char) (ch - 0x09) <= 0x04;
+}
+
+int
+is_printable_scalar(const u_char *cp, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        if (!is_printable_octet(cp[i])) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+size_t
+escape_ascii_scalar(u_char *out, const u_char *cp, size_t len) {
+    u_char *op = out;
+
+    for (size_t i = 0; i < len; i++) {
+        u_char ch = cp[i];
+        if (is_printable_octet(ch)) {
+            if (ch == '\\' || ch == '"') {
+                *op++ = '\\';
+            }
+            *op++ = ch;
+        } else {
+            *op++ = '.';
+        }
+    }
+    return op - out;
+}
+
+size_t
+to_hex_scalar(u_char *out, const u_char *cp, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        out[0] = hex_digits[cp[i] >> 4];
+        out[1] = hex_digits[cp[i] & 0x0F];
+        out[2] = ' ';
+        out += 3;
+    }
+    return len * 3;
+}
+
+#ifdef STRING_KERNELS_X86
+
+/*
+ * An octet is printable when (ch - 0x20) <= 0x5E or (ch - 0x09) <= 0x04,
+ * both compared unsigned.  x <= k is computed as min_epu8(x, k) == x.
+ */
+__attribute__((target("sse2"))) inline __m128i
+printable_mask_sse2(__m128i b) {
+    const __m128i d1 = _mm_sub_epi8(b, _mm_set1_epi8(0x20));
+    const __m128i d2 = _mm_sub_epi8(b, _mm_set1_epi8(0x09));
+    return _mm_or_si128(_mm_cmpeq_epi8(_mm_min_epu8(d1, _mm_set1_epi8(0x5E)), d1),
+                        _mm_cmpeq_epi8(_mm_min_epu8(d2, _mm_set1_epi8(0x04)), d2));
+}
+
+__attribute__((target("avx2"))) inline __m256i
+printable_mask_avx2(__m256i b) {
+    const __m256i d1 = _mm256_sub_epi8(b, _mm256_set1_epi8(0x20));
+    const __m256i d2 = _mm256_sub_epi8(b, _mm256_set1_epi8(0x09));
+    return _mm256_or_si256(_mm256_cmpeq_epi8(_mm256_min_epu8(d1, _mm256_set1_epi8(0x5E)), d1),
+                           _mm256_cmpeq_epi8(_mm256_min_epu8(d2, _mm256_set1_epi8(0x04)), d2));
+}
+
+__attribute__((target("sse2"))) int
+is_printable_sse2(const u_char *cp, size_t len) {
+    size_t i = 0;
+
+    for (; i + 16 <= len; i += 16) {
+        __m128i b = _mm_loadu_si128((const __m128i *) (cp + i));
+        if (_mm_movemask_epi8(printable_mask_sse2(b)) != 0xFFFF) {
+            return 0;
+        }
+    }
+    return is_printable_scalar(cp + i, len - i);
+}
+
+__attribute__((target("avx2"))) int
+is_printable_avx2(const u_char *cp, size_t len) {
+    size_t i = 0;
+
+    for (; i + 32 <= len; i += 32) {
+        __m256i b = _mm256_loadu_si256((const __m256i *) (cp + i));
+        if ((unsigned) _mm256_movemask_epi8(printable_mask_avx2(b)) != 0xFFFFFFFFU) {
+            return 0;
+        }
+    }
+    return is_printable_sse2(cp + i, len - i);
+}
+
+/*
+ * Copies whole blocks that need no escaping; on the first octet that does,
+ * the clean prefix is kept, that octet is escaped and the scan restarts
+ * right after it.  Full-width stores are safe because out has room for
+ * 2 * len bytes.
+ */
+__attribute__((target("sse2"))) size_t
+escape_ascii_sse2(u_char *out, const u_char *cp, size_t len) {
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i quote = _mm_set1_epi8('"');
+    u_char *op = out;
+    size_t i = 0;
+
+    while (i + 16 <= len) {
+        __m128i b = _mm_loadu_si128((const __m128i *) (cp + i));
+        __m128i special = _mm_or_si128(_mm_cmpeq_epi8(b, backslash),
+                                       _mm_cmpeq_epi8(b, quote));
+        unsigned dirty = ~(unsigned) _mm_movemask_epi8(
+                _mm_andnot_si128(special, printable_mask_sse2(b))) & 0xFFFFU;
+
+        _mm_storeu_si128((__m128i *) op, b);
+        if (!dirty) {
+            op += 16;
+            i += 16;
+            continue;
+        }
+        unsigned n = __builtin_ctz(dirty);
+        op += n;
+        i += n;
+        op += escape_ascii_scalar(op, cp + i, 1);
+        i++;
+    }
+    return (op - out) + escape_ascii_scalar(op, cp + i, len - i);
+}
+
+__attribute__((target("avx2"))) size_t
+escape_ascii_avx2(u_char *out, const u_char *cp, size_t len) {
+    const __m256i backslash = _mm256_set1_epi8('\\');
+    const __m256i quote = _mm256_set1_epi8('"');
+    u_char *op = out;
+    size_t i = 0;
+
+    while (i + 32 <= len) {
+        __m256i b = _mm256_loadu_si256((const __m256i *) (cp + i));
+        __m256i special = _mm256_or_si256(_mm256_cmpeq_epi8(b, backslash),
+                                          _mm256_cmpeq_epi8(b, quote));
+        unsigned dirty = ~(unsigned) _mm256_movemask_epi8(
+                _mm256_andnot_si256(special, printable_mask_avx2(b)));
+
+        _mm256_storeu_si256((__m256i *) op, b);
+        if (!dirty) {
+            op += 32;
+            i += 32;
+            continue;
+        }
+        unsigned n = __builtin_ctz(dirty);
+        op += n;
+        i += n;
+        op += escape_ascii_scalar(op, cp + i, 1);
+        i++;
+    }
+    return (op - out) + escape_ascii_sse2(op, cp + i, len - i);
+}
+
+/*
+ * pshufb masks spreading 16 high-nibble and 16 low-nibble digits over
+ * 48 output bytes "HL HL HL ...": output byte p takes the high digit of
+ * octet p / 3 when p % 3 == 0, the low digit when p % 3 == 1 and a space
+ * otherwise.  0x80 in a mask selects zero.
+ */
+struct hex_layout {
+    alignas(16) char hi[3][16];
+    alignas(16) char lo[3][16];
+    alignas(16) char space[3][16];
+};
+
+constexpr hex_layout
+make_hex_layout() {
+    hex_layout l{};
+    for (int p = 0; p < 48; p++) {
+        int c = p / 16, j = p % 16, octet = p / 3;
+        l.hi[c][j] = p % 3 == 0 ? (char) octet : (char) -128;
+        l.lo[c][j] = p % 3 == 1 ? (char) octet : (char) -128;
+        l.space[c][j] = p % 3 == 2 ? ' ' : 0;
+    }
+    return l;
+}
+
+constexpr hex_layout hex_shuffle = make_hex_layout();
+
+__attribute__((target("ssse3"))) size_t
+to_hex_ssse3(u_char *out, const u_char *cp, size_t len) {
+    const __m128i digits = _mm_loadu_si128((const __m128i *) hex_digits);
+    const __m128i nibble = _mm_set1_epi8(0x0F);
+    u_char *op = out;
+    size_t i = 0;
+
+    for (; i + 16 <= len; i += 16) {
+        __m128i b = _mm_loadu_si128((const __m128i *) (cp + i));
+        __m128i hi = _mm_shuffle_epi8(digits, _mm_and_si128(_mm_srli_epi16(b, 4), nibble));
+        __m128i lo = _mm_shuffle_epi8(digits, _mm_and_si128(b, nibble));
+        for (int c = 0; c < 3; c++) {
+            __m128i v = _mm_or_si128(
+                    _mm_shuffle_epi8(hi, _mm_load_si128((const __m128i *) hex_shuffle.hi[c])),
+                    _mm_shuffle_epi8(lo, _mm_load_si128((const __m128i *) hex_shuffle.lo[c])));
+            v = _mm_or_si128(v, _mm_load_si128((const __m128i *) hex_shuffle.space[c]));
+            _mm_storeu_si128((__m128i *) (op + 16 * c), v);
+        }
+        op += 48;
+    }
+    to_hex_scalar(op, cp + i, len - i);
+    return len * 3;
+}
+
+#endif // STRING_KERNELS_X86
+
+struct string_kernels {
+    int (*is_printable)(const u_char *, size_t);
+    size_t (*escape_ascii)(u_char *, const u_char *, size_t);
+    size_t (*to_hex)(u_char *, const u_char *, size_t);
+};
+
+string_kernels
+select_string_kernels() {
+    string_kernels k = {is_printable_scalar, escape_ascii_scalar, to_hex_scalar};
+
+#ifdef STRING_KERNELS_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse2")) {
+        k.is_printable = is_printable_sse2;
+        k.escape_ascii = escape_ascii_sse2;
+    }
+    if (__builtin_cpu_supports("ssse3")) {
+        k.to_hex = to_hex_ssse3;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        k.is_printable = is_printable_avx2;
+        k.escape_ascii = escape_ascii_avx2;
+    }
+#endif
+    return k;
+}
+
+const string_kernels kernels = select_string_kernels();
+
+} // namespace
+
+int
+octet_string_is_printable(const u_char *cp, size_t len) {
+    return kernels.is_printable(cp, len);
+}
+
+size_t
+octet_string_escape_ascii(u_char *out, const u_char *cp, size_t len) {
+    return kernels.escape_ascii(out, cp, len);
+}
+
+size_t
+octet_string_to_hex(u_char *out, const u_char *cp, size_t len) {
+    return kernels.to_hex(out, cp, len);
+}
@@ -0,0 +1,59 @@
+#ifndef STRING_KERNELS_H
+#define STRING_KERNELS_H
+
+#include <cstddef>
+
+#include "shared_constants.h"
+
+/*
+ * Bulk kernels behind the octet string printers of mib_handler.cc.
+ *
+ * Each routine is selected once at load time: AVX2 or SSE2/SSSE3 on x86-64
+ * when the CPU supports it, a table-driven scalar loop everywhere else.
+ * All variants produce byte-identical output.
+ *
+ * "printable" follows isprint() || isspace() of the "C" locale, which is
+ * the only locale this library runs in: 0x09..0x0D and 0x20..0x7E.
+ */
+
+/**
+ * octet_string_is_printable - tests whether every byte of a string would be
+ * printed as-is by sprint_realloc_asciistring.
+ *
+ * @param cp   IN - the octets to classify
+ * @param len  IN - number of octets
+ *
+ * @return 1 if all octets are printable or white space, 0 otherwise
+ *         (the octet string is then rendered as Hex-STRING).
+ */
+int
+octet_string_is_printable(const u_char *cp, size_t len);
+
+/**
+ * octet_string_escape_ascii - renders an octet string the way
+ * sprint_realloc_asciistring does: '\\' and '"' are escaped with a
+ * backslash, non-printable octets become '.'.
+ *
+ * @param out  OUT - destination, must have room for 2 * len bytes
+ * @param cp   IN  - the octets to encode
+ * @param len  IN  - number of octets
+ *
+ * @return number of bytes written to out (no NUL terminator is added)
+ */
+size_t
+octet_string_escape_ascii(u_char *out, const u_char *cp, size_t len);
+
+/**
+ * octet_string_to_hex - renders an octet string as "%02X " per octet.
+ *
+ * @param out  OUT - destination, must have room for 3 * len bytes
+ * @param cp   IN  - the octets to encode
+ * @param len  IN  - number of octets
+ *
+ * @return number of bytes written to out, always 3 * len
+ *         (no NUL terminator is added)
+ */
+size_t
+octet_string_to_hex(u_char *out, const u_char *cp, size_t len);
+
+#endif // STRING_KERNELS_H
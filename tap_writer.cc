@@ -0,0 +1,431 @@
+#include "tap_writer.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstdio>
+#include <ctime>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#if __has_include( <zlib.h> )
+#include <zlib.h>
+#define TAP_WRITER_GZIP 1
+#endif
+#if __has_include( <zstd.h> )
+#include <zstd.h>
+#define TAP_WRITER_ZSTD 1
+#endif
+
+/*
+ * A compression stream.  Compress() takes text into the current frame;
+ * Flush() makes everything taken so far decodable and, with end_frame,
+ * closes the frame so the next text starts a new one.  Both append what
+ * the codec gives to out.
+ */
+class TapWriter::Compressor {
+public:
+    Compressor( Compression codec, int level ) : m_Codec( codec ) {
+#ifdef TAP_WRITER_GZIP
+        if ( codec == GZIP ) {
+            /* 16 over the window bits asks for a gzip wrapper */
+            m_Ok = deflateInit2( &m_Gzip, level ? level : Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8,
+                                 Z_DEFAULT_STRATEGY )
+                   == Z_OK;
+        }
+#endif
+#ifdef TAP_WRITER_ZSTD
+        if ( codec == ZSTD ) {
+            m_Zstd = ZSTD_createCCtx();
+            m_Ok   = m_Zstd && !ZSTD_isError( ZSTD_CCtx_setParameter( m_Zstd, ZSTD_c_compressionLevel, level ) )
+                   && !ZSTD_isError( ZSTD_CCtx_setParameter( m_Zstd, ZSTD_c_checksumFlag, 1 ) );
+        }
+#endif
+        (void) level;
+    }
+
+    ~Compressor() {
+#ifdef TAP_WRITER_GZIP
+        if ( m_Codec == GZIP && m_Ok ) {
+            deflateEnd( &m_Gzip );
+        }
+#endif
+#ifdef TAP_WRITER_ZSTD
+        ZSTD_freeCCtx( m_Zstd );
+#endif
+    }
+
+    bool Ok() const { return m_Ok; }
+
+    /** Drops the open frame; the next text starts a new one. */
+    void Reset() {
+#ifdef TAP_WRITER_GZIP
+        if ( m_Codec == GZIP ) {
+            deflateReset( &m_Gzip );
+        }
+#endif
+#ifdef TAP_WRITER_ZSTD
+        if ( m_Codec == ZSTD ) {
+            ZSTD_CCtx_reset( m_Zstd, ZSTD_reset_session_only );
+        }
+#endif
+    }
+
+    bool Compress( const std::string &text, std::string &out ) {
+#ifdef TAP_WRITER_GZIP
+        if ( m_Codec == GZIP ) {
+            return gzip( text.data(), text.size(), out, Z_NO_FLUSH );
+        }
+#endif
+#ifdef TAP_WRITER_ZSTD
+        if ( m_Codec == ZSTD ) {
+            return zstd( text.data(), text.size(), out, ZSTD_e_continue );
+        }
+#endif
+        return false;
+    }
+
+    bool Flush( std::string &out, bool end_frame ) {
+#ifdef TAP_WRITER_GZIP
+        if ( m_Codec == GZIP ) {
+            return gzip( nullptr, 0, out, end_frame ? Z_FINISH : Z_SYNC_FLUSH );
+        }
+#endif
+#ifdef TAP_WRITER_ZSTD
+        if ( m_Codec == ZSTD ) {
+            return zstd( nullptr, 0, out, end_frame ? ZSTD_e_end : ZSTD_e_flush );
+        }
+#endif
+        (void) out;
+        (void) end_frame;
+        return false;
+    }
+
+private:
+#ifdef TAP_WRITER_GZIP
+    bool gzip( const char *data, size_t len, std::string &out, int flush ) {
+        static const size_t CHUNK = 64 * 1024;
+        m_Gzip.next_in            = (Bytef *) data;
+        m_Gzip.avail_in           = len;
+        for ( ;; ) {
+            size_t start = out.size();
+            out.resize( start + CHUNK );
+            m_Gzip.next_out  = (Bytef *) &out[start];
+            m_Gzip.avail_out = CHUNK;
+            int rc           = deflate( &m_Gzip, flush );
+            out.resize( start + CHUNK - m_Gzip.avail_out );
+            if ( rc == Z_STREAM_ERROR ) {
+                return false;
+            }
+            if ( flush == Z_FINISH ) {
+                if ( rc == Z_STREAM_END ) {
+                    /* the next text starts another gzip member */
+                    return deflateReset( &m_Gzip ) == Z_OK;
+                }
+            } else if ( m_Gzip.avail_in == 0 && m_Gzip.avail_out != 0 ) {
+                return true;
+            }
+        }
+    }
+
+    z_stream m_Gzip{};
+#endif
+#ifdef TAP_WRITER_ZSTD
+    bool zstd( const char *data, size_t len, std::string &out, ZSTD_EndDirective mode ) {
+        ZSTD_inBuffer in{ data, len, 0 };
+        for ( ;; ) {
+            size_t start = out.size();
+            size_t room  = ZSTD_CStreamOutSize();
+            out.resize( start + room );
+            ZSTD_outBuffer buffer{ &out[start], room, 0 };
+            size_t         left = ZSTD_compressStream2( m_Zstd, &buffer, &in, mode );
+            out.resize( start + buffer.pos );
+            if ( ZSTD_isError( left ) ) {
+                return false;
+            }
+            if ( mode == ZSTD_e_continue ? in.pos == in.size : left == 0 ) {
+                return true;
+            }
+        }
+    }
+
+    ZSTD_CCtx *m_Zstd = nullptr;
+#endif
+
+    Compression m_Codec;
+    bool        m_Ok = false;
+};
+
+namespace {
+    /* writev until everything went out; false on an error. */
+    bool write_all( int fd, iovec *iov, int count ) {
+        while ( count > 0 ) {
+            ssize_t n = writev( fd, iov, count );
+            if ( n < 0 ) {
+                if ( errno == EINTR ) {
+                    continue;
+                }
+                return false;
+            }
+            while ( count > 0 && (size_t) n >= iov->iov_len ) {
+                n -= iov->iov_len;
+                iov++;
+                count--;
+            }
+            if ( count > 0 ) {
+                iov->iov_base = (char *) iov->iov_base + n;
+                iov->iov_len -= n;
+            }
+        }
+        return true;
+    }
+} // namespace
+
+TapWriter::TapWriter( std::string path, Policy policy ) : m_Path( std::move( path ) ), m_Policy( policy ) {}
+
+TapWriter::~TapWriter() {
+    if ( m_Thread.joinable() ) {
+        {
+            std::lock_guard<std::mutex> lock( m_Mutex );
+            m_Stop = true;
+        }
+        m_Wake.notify_one();
+        m_Thread.join();
+    }
+    endFrame();
+    if ( m_Fd >= 0 ) {
+        close( m_Fd );
+    }
+}
+
+bool TapWriter::Supported( Compression compression ) {
+    switch ( compression ) {
+        case NONE:
+            return true;
+#ifdef TAP_WRITER_GZIP
+        case GZIP:
+            return true;
+#endif
+#ifdef TAP_WRITER_ZSTD
+        case ZSTD:
+            return true;
+#endif
+        default:
+            return false;
+    }
+}
+
+bool TapWriter::Open() {
+    if ( m_Policy.compression != NONE ) {
+        m_Compressor = std::make_unique<Compressor>( m_Policy.compression, m_Policy.compression_level );
+        if ( !m_Compressor->Ok() ) {
+            m_Compressor.reset();
+            return false;
+        }
+    }
+    if ( !openFile() ) {
+        return false;
+    }
+    m_Thread = std::thread( &TapWriter::run, this );
+    return true;
+}
+
+bool TapWriter::openFile() {
+    m_Fd = open( m_Path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644 );
+    if ( m_Fd < 0 ) {
+        return false;
+    }
+    struct stat st;
+    m_FileBytes = fstat( m_Fd, &st ) == 0 ? st.st_size : 0;
+    m_Opened    = std::chrono::steady_clock::now();
+    return true;
+}
+
+void TapWriter::Write( std::string record ) {
+    size_t bytes = record.size();
+    /* counted before the node is published, so the writer never takes it off first */
+    size_t before = m_QueuedBytes.fetch_add( bytes );
+    if ( m_Policy.max_queued_bytes && before + bytes > m_Policy.max_queued_bytes ) {
+        m_QueuedBytes.fetch_sub( bytes );
+        m_Dropped.fetch_add( 1, std::memory_order_relaxed );
+        return;
+    }
+    m_Queued.fetch_add( 1, std::memory_order_relaxed );
+    Node *node = new Node{ m_Head.load( std::memory_order_relaxed ), std::move( record ) };
+    while ( !m_Head.compare_exchange_weak( node->next, node ) ) {
+    }
+    /* the writer only needs waking for a first record, or for enough to flush */
+    if ( m_Idle || ( before < m_Policy.flush_bytes && before + bytes >= m_Policy.flush_bytes ) ) {
+        std::lock_guard<std::mutex> lock( m_Mutex );
+        m_Wake.notify_one();
+    }
+}
+
+void TapWriter::run() {
+    std::vector<Node *>                   pending;
+    size_t                                pending_bytes = 0;
+    std::chrono::steady_clock::time_point oldest;
+    for ( ;; ) {
+        bool stop = m_Stop;
+        /* taken newest first, so reversed to keep the order written */
+        Node  *list  = m_Head.exchange( nullptr );
+        size_t first = pending.size();
+        for ( ; list; list = list->next ) {
+            pending.push_back( list );
+            pending_bytes += list->record.size();
+        }
+        std::reverse( pending.begin() + first, pending.end() );
+        if ( first == 0 && !pending.empty() ) {
+            oldest = std::chrono::steady_clock::now();
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        if ( !pending.empty()
+             && ( stop || pending_bytes >= m_Policy.flush_bytes || now - oldest >= m_Policy.flush_interval ) ) {
+            writeOut( pending, pending_bytes );
+            pending_bytes = 0;
+        }
+        if ( stop ) {
+            return; // nothing is queued after m_Stop, the destructor is running
+        }
+
+        std::unique_lock<std::mutex> lock( m_Mutex );
+        auto                         woken = [this] {
+            return m_Stop || ( m_Head.load() && ( m_Idle || m_QueuedBytes >= m_Policy.flush_bytes ) );
+        };
+        if ( pending.empty() ) {
+            m_Idle = true;
+            m_Wake.wait( lock, woken );
+            m_Idle = false;
+        } else {
+            m_Wake.wait_until( lock, oldest + m_Policy.flush_interval, woken );
+        }
+    }
+}
+
+/*
+ * With compression the size that counts against rotate_bytes is that of
+ * the compressed file, which is only known after writing, so it rotates
+ * once the file has reached rotate_bytes.
+ */
+void TapWriter::writeOut( std::vector<Node *> &pending, size_t bytes ) {
+    auto     now     = std::chrono::steady_clock::now();
+    uint64_t growing = m_Compressor ? 0 : bytes;
+    if ( m_Fd >= 0 && m_FileBytes > 0
+         && ( ( m_Policy.rotate_bytes && m_FileBytes + growing > m_Policy.rotate_bytes )
+              || ( m_Policy.rotate_interval.count() && now - m_Opened >= m_Policy.rotate_interval ) ) ) {
+        rotate();
+    }
+    if ( m_Fd < 0 && !openFile() ) {
+        //MLOG( ERROR ) << "Could not reopen tap file \"" << m_Path << "\": " << strerror( errno );
+    }
+
+    iovec  iov[IOV_MAX < 1024 ? IOV_MAX : 1024];
+    int    count = 0;
+    size_t chunk = 0;
+    for ( size_t i = 0; ( m_Policy.echo || !m_Compressor ) && i < pending.size(); i++ ) {
+        iov[count++] = { pending[i]->record.data(), pending[i]->record.size() };
+        chunk += pending[i]->record.size();
+        if ( count == (int) ( sizeof( iov ) / sizeof( iov[0] ) ) || i + 1 == pending.size() ) {
+            if ( m_Policy.echo ) {
+                iovec echo[sizeof( iov ) / sizeof( iov[0] )];
+                std::copy( iov, iov + count, echo );
+                write_all( STDOUT_FILENO, echo, count );
+            }
+            if ( !m_Compressor ) {
+                if ( m_Fd >= 0 && write_all( m_Fd, iov, count ) ) {
+                    m_FileBytes += chunk;
+                } else {
+                    //MLOG( ERROR ) << "Could not write tap file \"" << m_Path << "\": " << strerror( errno );
+                }
+            }
+            count = 0;
+            chunk = 0;
+        }
+    }
+    if ( m_Compressor ) {
+        if ( m_FrameBytes == 0 ) {
+            m_FrameStart = m_FileBytes;
+        }
+        bool ok = true;
+        for ( Node *node : pending ) {
+            ok = ok && m_Compressor->Compress( node->record, m_Compressed );
+        }
+        m_FrameBytes += bytes;
+        bool end_frame = m_FrameBytes >= m_Policy.frame_bytes;
+        ok             = ok && m_Compressor->Flush( m_Compressed, end_frame );
+        iovec out{ m_Compressed.data(), m_Compressed.size() };
+        if ( ok && m_Fd >= 0 && write_all( m_Fd, &out, 1 ) ) {
+            m_FileBytes += m_Compressed.size();
+            if ( end_frame ) {
+                m_FrameBytes = 0;
+            }
+        } else {
+            //MLOG( ERROR ) << "Could not write tap file \"" << m_Path << "\": " << strerror( errno );
+            dropFrame();
+        }
+        m_Compressed.clear();
+    }
+
+    for ( Node *node : pending ) {
+        delete node;
+    }
+    m_Queued.fetch_sub( pending.size(), std::memory_order_relaxed );
+    m_QueuedBytes.fetch_sub( bytes );
+    pending.clear();
+}
+
+/* Closes the open frame, if any, so the file ends on a frame boundary. */
+void TapWriter::endFrame() {
+    if ( !m_Compressor || m_FrameBytes == 0 ) {
+        return;
+    }
+    m_FrameBytes = 0;
+    bool  ok = m_Compressor->Flush( m_Compressed, true );
+    iovec out{ m_Compressed.data(), m_Compressed.size() };
+    if ( ok && m_Fd >= 0 && write_all( m_Fd, &out, 1 ) ) {
+        m_FileBytes += m_Compressed.size();
+    } else {
+        dropFrame();
+    }
+    m_Compressed.clear();
+}
+
+/*
+ * Once a write of the open frame is skipped or fails, the stream in the
+ * file can no longer be continued: the frame is cut from the file, so
+ * that it ends on a frame boundary again, and the next text starts a new
+ * one.  The records in that frame are what is lost.
+ */
+void TapWriter::dropFrame() {
+    m_Compressor->Reset();
+    m_FrameBytes = 0;
+    if ( m_Fd >= 0 && ftruncate( m_Fd, m_FrameStart ) == 0 ) {
+        m_FileBytes = m_FrameStart;
+    }
+}
+
+/* Renames the file to path.YYYYmmdd-HHMMSS, with .N added if that is taken, and starts a new one. */
+void TapWriter::rotate() {
+    endFrame();
+    time_t    now = time( nullptr );
+    struct tm parsed;
+    char      suffix[32];
+    localtime_r( &now, &parsed );
+    strftime( suffix, sizeof( suffix ), ".%Y%m%d-%H%M%S", &parsed );
+
+    std::string target = m_Path + suffix;
+    struct stat st;
+    for ( int n = 1; stat( target.c_str(), &st ) == 0; n++ ) {
+        target = m_Path + suffix + "." + std::to_string( n );
+    }
+    close( m_Fd );
+    if ( rename( m_Path.c_str(), target.c_str() ) < 0 ) {
+        //MLOG( ERROR ) << "Could not rotate tap file \"" << m_Path << "\": " << strerror( errno );
+    }
+    if ( !openFile() ) {
+        //MLOG( ERROR ) << "Could not reopen tap file \"" << m_Path << "\": " << strerror( errno );
+    }
+}
@@ -0,0 +1,113 @@
+#ifndef SNMP_SHARED_LIB_TAP_WRITER_H
+#define SNMP_SHARED_LIB_TAP_WRITER_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * Appends tap records to a file from a thread of its own.
+ *
+ * Write() pushes a record onto a lock-free list and returns; the writer
+ * thread takes everything queued at once and writes it out with writev
+ * once flush_bytes have gathered or the oldest record has waited
+ * flush_interval.  Before a write, the file is renamed aside with a
+ * timestamp suffix if the write would take it past rotate_bytes or it
+ * has been open rotate_interval, and a new one started; records are
+ * never split, so one write can overshoot rotate_bytes.  Should the file
+ * fail to reopen after rotating, opening it is tried again before every
+ * write; records written while it cannot be opened are lost.
+ *
+ * Past max_queued_bytes, Write() drops the record and counts it, so that
+ * a writer held up by a stalled disk cannot take all memory.
+ *
+ * With compression, the writer thread streams the records through gzip
+ * or zstd.  Every write ends with a flush, so what reached the file can
+ * be decoded up to the last write, and a frame (a gzip member or zstd
+ * frame) is closed once frame_bytes of text went into it, and before
+ * rotating.  A frame can be decoded on its own, and the concatenated
+ * frames of a file decode as one stream with zcat or zstdcat.  A write
+ * that fails or is skipped cuts the open frame from the file, so that
+ * the file stays decodable and only that frame's records are lost.
+ */
+class TapWriter {
+public:
+    enum Compression { NONE, GZIP, ZSTD };
+
+    struct Policy {
+        size_t                    flush_bytes = 64 * 1024;
+        std::chrono::milliseconds flush_interval{ 1000 };
+        uint64_t                  rotate_bytes = 0;     // 0 never rotates on size
+        std::chrono::seconds      rotate_interval{ 0 }; // 0 never rotates on age
+        bool                      echo = false;         // copy every record to stdout
+        Compression               compression = NONE;
+        int                       compression_level = 0;         // 0 is the codec's default
+        size_t                    frame_bytes       = 4 << 20;   // uncompressed bytes per frame
+        size_t                    max_queued_bytes  = 256 << 20; // 0 queues without bound
+    };
+
+    /** Whether the library was built with the codec. */
+    static bool Supported( Compression compression );
+
+    TapWriter( std::string path, Policy policy );
+    ~TapWriter();
+
+    TapWriter( const TapWriter & )            = delete;
+    TapWriter &operator=( const TapWriter & ) = delete;
+
+    /** Opens the file and starts the writer thread. */
+    bool Open();
+
+    /** Queues a record, which should end with a newline.  Safe from any thread. */
+    void Write( std::string record );
+
+    /** Records queued and not yet written. */
+    size_t GetQueued() const { return m_Queued.load( std::memory_order_relaxed ); }
+
+    /** Records dropped because max_queued_bytes were queued. */
+    uint64_t GetDropped() const { return m_Dropped.load( std::memory_order_relaxed ); }
+
+private:
+    struct Node {
+        Node       *next;
+        std::string record;
+    };
+    class Compressor;
+
+    void run();
+    void writeOut( std::vector<Node *> &pending, size_t bytes );
+    bool openFile();
+    void rotate();
+    void endFrame();
+    void dropFrame();
+
+    std::string m_Path;
+    Policy      m_Policy;
+    int         m_Fd = -1;
+    uint64_t    m_FileBytes = 0;
+
+    std::unique_ptr<Compressor> m_Compressor;
+    std::string                 m_Compressed;
+    size_t                      m_FrameBytes = 0; // text in the open frame
+    uint64_t                    m_FrameStart = 0; // where the open frame starts in the file
+
+    std::chrono::steady_clock::time_point m_Opened;
+
+    std::atomic<Node *>     m_Head{ nullptr }; // newest first
+    std::atomic<size_t>     m_Queued{ 0 };
+    std::atomic<size_t>     m_QueuedBytes{ 0 };
+    std::atomic<uint64_t>   m_Dropped{ 0 };
+    std::atomic<bool>       m_Idle{ false }; // the writer sleeps until a record comes
+    std::atomic<bool>       m_Stop{ false };
+    std::mutex              m_Mutex;
+    std::condition_variable m_Wake;
+    std::thread             m_Thread;
+};
+
+#endif // SNMP_SHARED_LIB_TAP_WRITER_H
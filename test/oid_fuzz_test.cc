@@ -0,0 +1,118 @@
+/*
+ * Fuzz-equivalence test of BerReader::ReadObjid against asn_parse_objid:
+ * both decode random and biased OID encodings, truncated ones and small
+ * output buffers included, and must agree on the result, the subids, the
+ * error class and where they stop.
+ *
+ *   oid_fuzz_test [seed [iterations]]
+ */
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "ber_reader.h"
+
+namespace {
+    /* base-128 subid encodings: random bytes, one-byte subids, mostly small, or any width */
+    std::vector<uint8_t> random_contents( std::mt19937_64 &rng ) {
+        std::vector<uint8_t> contents;
+        size_t               count = rng() % 4 == 0 ? rng() % 300 : rng() % 40;
+        int                  style = rng() % 4;
+        while ( contents.size() < count ) {
+            uint64_t value;
+            switch ( style ) {
+                case 0:
+                    contents.push_back( rng() );
+                    continue;
+                case 1:
+                    value = rng() % 128;
+                    break;
+                case 2:
+                    value = rng() % 3 ? rng() % 128 : rng() % 20000;
+                    break;
+                default: {
+                    int bits = rng() % 40;
+                    value    = bits ? rng() & ( ( uint64_t( 1 ) << bits ) - 1 ) : 0;
+                }
+            }
+            uint8_t encoded[10];
+            int     n    = 0;
+            encoded[n++] = value & 0x7f;
+            while ( value >>= 7 ) {
+                encoded[n++] = 0x80 | ( value & 0x7f );
+            }
+            while ( n ) {
+                contents.push_back( encoded[--n] );
+            }
+        }
+        /* a continuation bit on the last byte is invalid */
+        if ( rng() % 8 == 0 && !contents.empty() ) {
+            contents.back() |= 0x80;
+        }
+        contents.resize( std::min<size_t>( contents.size(), 1000 ) );
+        return contents;
+    }
+} // namespace
+
+int main( int argc, char **argv ) {
+    std::mt19937_64 rng( argc > 1 ? strtoull( argv[1], nullptr, 0 ) : 1 );
+    long            iterations = argc > 2 ? atol( argv[2] ) : 500000;
+    long            decoded = 0, rejected = 0;
+
+    for ( long it = 0; it < iterations; it++ ) {
+        std::vector<uint8_t> contents = random_contents( rng );
+        std::vector<uint8_t> packet   = { ASN_OBJECT_ID };
+        if ( contents.size() < 128 ) {
+            packet.push_back( contents.size() );
+        } else {
+            packet.insert( packet.end(), { 0x82, uint8_t( contents.size() >> 8 ), uint8_t( contents.size() ) } );
+        }
+        packet.insert( packet.end(), contents.begin(), contents.end() );
+        /* sometimes a value follows, as in a varbind */
+        if ( rng() % 2 ) {
+            packet.insert( packet.end(), { ASN_INTEGER, 0x01, 0x07 } );
+        }
+
+        size_t   room = rng() % 3 ? MAX_OID_LEN : 1 + rng() % MAX_OID_LEN;
+        oid      expected[MAX_OID_LEN] = {}, actual[MAX_OID_LEN] = {};
+        size_t   expected_len = room, actual_len = room, left = packet.size();
+        u_char   expected_type;
+        uint8_t  actual_type;
+        uint64_t errors_before[ASN_ERR_CLASSES];
+        for ( int i = 0; i < ASN_ERR_CLASSES; i++ ) {
+            errors_before[i] = snmp_parse_error_count( i );
+        }
+
+        u_char *next = asn_parse_objid( packet.data(), &left, &expected_type, expected, &expected_len );
+        int     expected_error = -1;
+        for ( int i = 0; i < ASN_ERR_CLASSES; i++ ) {
+            if ( snmp_parse_error_count( i ) != errors_before[i] ) {
+                expected_error = i;
+            }
+        }
+        BerReader reader( std::span<const uint8_t>( packet.data(), packet.size() ) );
+        bool      ok = reader.ReadObjid( actual_type, actual, actual_len );
+
+        bool same = ( next != nullptr ) == ok;
+        if ( same && ok ) {
+            same = expected_len == actual_len && !memcmp( expected, actual, actual_len * sizeof( oid ) )
+                   && expected_type == actual_type && packet.data() + packet.size() - reader.Remaining() == next;
+        } else if ( same ) {
+            same = expected_error == reader.Error();
+        }
+        if ( !same ) {
+            printf( "mismatch at iteration %ld:", it );
+            for ( uint8_t b : packet ) {
+                printf( " %02x", b );
+            }
+            printf( "\n" );
+            return 1;
+        }
+        ok ? decoded++ : rejected++;
+    }
+    printf( "%ld decoded, %ld rejected, all equal\n", decoded, rejected );
+    return 0;
+}
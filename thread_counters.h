@@ -0,0 +1,99 @@
+#ifndef SNMP_SHARED_LIB_THREAD_COUNTERS_H
+#define SNMP_SHARED_LIB_THREAD_COUNTERS_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/**
+ * N counters kept in a cache line of their own for every thread that adds
+ * to them, and summed when read.
+ *
+ * Only the owning thread writes a slot, so adding is a plain load and
+ * store with no locked instruction and no line shared between threads.
+ * A thread takes the mutex once, the first time it adds; reading takes
+ * it to walk the slots.  Slots outlive their threads, so the sums keep
+ * what finished threads counted.
+ */
+template <size_t N>
+class ThreadCounters {
+public:
+    ThreadCounters() : m_Id( nextId() ) {}
+
+    ThreadCounters( const ThreadCounters & )            = delete;
+    ThreadCounters &operator=( const ThreadCounters & ) = delete;
+
+    void Add( size_t counter, uint64_t n = 1 ) {
+        std::atomic<uint64_t> &value = slot().values[counter];
+        value.store( value.load( std::memory_order_relaxed ) + n, std::memory_order_relaxed );
+    }
+
+    /** Every counter summed over all threads. */
+    std::array<uint64_t, N> Read() const {
+        std::array<uint64_t, N>     sums{};
+        std::lock_guard<std::mutex> lock( m_Mutex );
+        for ( const auto &slot : m_Slots ) {
+            for ( size_t i = 0; i < N; i++ ) {
+                sums[i] += slot->values[i].load( std::memory_order_relaxed );
+            }
+        }
+        return sums;
+    }
+
+    uint64_t Read( size_t counter ) const {
+        uint64_t                    sum = 0;
+        std::lock_guard<std::mutex> lock( m_Mutex );
+        for ( const auto &slot : m_Slots ) {
+            sum += slot->values[counter].load( std::memory_order_relaxed );
+        }
+        return sum;
+    }
+
+private:
+    struct alignas( 64 ) Slot {
+        std::atomic<uint64_t> values[N] = {};
+    };
+
+    /*
+     * The calling thread's slot.  Threads remember theirs by the id of the
+     * instance, which is never reused, so an entry left behind by a
+     * destroyed instance is never matched again.
+     */
+    Slot &slot() {
+        struct Entry {
+            uint64_t id;
+            Slot    *slot;
+        };
+        static thread_local Entry              last{ 0, nullptr };
+        static thread_local std::vector<Entry> entries;
+        if ( last.id == m_Id ) {
+            return *last.slot;
+        }
+        for ( const auto &entry : entries ) {
+            if ( entry.id == m_Id ) {
+                last = entry;
+                return *last.slot;
+            }
+        }
+        std::lock_guard<std::mutex> lock( m_Mutex );
+        m_Slots.push_back( std::make_unique<Slot>() );
+        entries.push_back( { m_Id, m_Slots.back().get() } );
+        last = entries.back();
+        return *last.slot;
+    }
+
+    static uint64_t nextId() {
+        static std::atomic<uint64_t> ids{ 0 };
+        return ids.fetch_add( 1, std::memory_order_relaxed ) + 1;
+    }
+
+    const uint64_t                     m_Id;
+    mutable std::mutex                 m_Mutex;
+    std::vector<std::unique_ptr<Slot>> m_Slots;
+};
+
+#endif // SNMP_SHARED_LIB_THREAD_COUNTERS_H
@@ -0,0 +1,63 @@
+#include "timestamp_format.h"
+
+#include <cstring>
+
+namespace {
+    /* Writes value as exactly width digits, zero padded, ending at end. */
+    void put_digits( char *end, unsigned value, int width ) {
+        while ( width-- > 0 ) {
+            *--end = (char) ( '0' + value % 10 );
+            value /= 10;
+        }
+    }
+} // namespace
+
+std::string TimestampFormatter::Format( int64_t ns ) {
+    time_t   second   = (time_t) ( ns / 1000000000 );
+    unsigned fraction = (unsigned) ( ns % 1000000000 );
+    if ( ns < 0 && fraction ) { // before 1970, the fraction still counts forward
+        second--;
+        fraction = (unsigned) ( ns % 1000000000 + 1000000000 );
+    }
+
+    if ( second != m_Second ) {
+        struct tm parsed;
+        if ( !localtime_r( &second, &parsed ) ) {
+            memset( &parsed, 0, sizeof( parsed ) );
+        }
+        char *p = m_Prefix;
+        put_digits( p + 4, parsed.tm_year + 1900, 4 );
+        p[4] = '-';
+        put_digits( p + 7, parsed.tm_mon + 1, 2 );
+        p[7] = '-';
+        put_digits( p + 10, parsed.tm_mday, 2 );
+        p[10] = ' ';
+        put_digits( p + 13, parsed.tm_hour, 2 );
+        p[13] = ':';
+        put_digits( p + 16, parsed.tm_min, 2 );
+        p[16] = ':';
+        put_digits( p + 19, parsed.tm_sec, 2 );
+        m_Second = second;
+    }
+
+    char   buf[PREFIX_LENGTH + 8];
+    size_t len = PREFIX_LENGTH;
+    memcpy( buf, m_Prefix, PREFIX_LENGTH );
+    if ( m_Precision == MILLISECONDS ) {
+        buf[len] = '.';
+        put_digits( buf + len + 4, fraction / 1000000, 3 );
+        len += 4;
+    } else if ( m_Precision == MICROSECONDS ) {
+        buf[len] = '.';
+        put_digits( buf + len + 7, fraction / 1000, 6 );
+        len += 7;
+    }
+    buf[len++] = ' ';
+    return std::string( buf, len );
+}
+
+std::string TimestampFormatter::Now() {
+    timespec ts;
+    clock_gettime( CLOCK_REALTIME, &ts );
+    return Format( (int64_t) ts.tv_sec * 1000000000 + ts.tv_nsec );
+}
@@ -0,0 +1,38 @@
+#ifndef SNMP_SHARED_LIB_TIMESTAMP_FORMAT_H
+#define SNMP_SHARED_LIB_TIMESTAMP_FORMAT_H
+
+#include <cstdint>
+#include <ctime>
+#include <string>
+
+/**
+ * Formats local times as "YYYY-MM-DD HH:MM:SS" with an optional fraction
+ * and a trailing space, the way AddTimestamp() always has.
+ *
+ * The date and time of day are worked out once a second with
+ * localtime_r() and kept; within the second only the fraction digits
+ * are written.  An instance is not thread-safe, use one per thread.
+ */
+class TimestampFormatter {
+public:
+    enum Precision { SECONDS, MILLISECONDS, MICROSECONDS };
+
+    explicit TimestampFormatter( Precision precision = SECONDS ) : m_Precision( precision ) {}
+
+    void SetPrecision( Precision precision ) { m_Precision = precision; }
+
+    /** ns is CLOCK_REALTIME nanoseconds, such as the kernel receive time. */
+    std::string Format( int64_t ns );
+
+    /** The current time. */
+    std::string Now();
+
+private:
+    static constexpr size_t PREFIX_LENGTH = 19; // "YYYY-MM-DD HH:MM:SS"
+
+    Precision m_Precision;
+    time_t    m_Second = -1;
+    char      m_Prefix[PREFIX_LENGTH];
+};
+
+#endif // SNMP_SHARED_LIB_TIMESTAMP_FORMAT_H
@@ -0,0 +1,81 @@
+#include "trap_filter.h"
+
+#include <algorithm>
+
+TrapOidFilter::TrapOidFilter() {
+    Clear();
+}
+
+void TrapOidFilter::Clear() {
+    m_Nodes.assign( 1, Node() );
+    m_Rules.clear();
+    m_HasAllow = false;
+    m_Unmatched.store( 0, std::memory_order_relaxed );
+}
+
+uint32_t TrapOidFilter::child( uint32_t node, oid subid ) const {
+    for ( const auto &[s, index] : m_Nodes[node].children ) {
+        if ( s == subid ) {
+            return index;
+        }
+        if ( s > subid ) {
+            break;
+        }
+    }
+    return NONE;
+}
+
+void TrapOidFilter::AddRule( std::span<const oid> prefix, Action action, std::string rule ) {
+    uint32_t node = 0;
+    for ( oid subid : prefix ) {
+        uint32_t next = child( node, subid );
+        if ( next == NONE ) {
+            next = (uint32_t) m_Nodes.size();
+            m_Nodes.emplace_back();
+            auto &children = m_Nodes[node].children;
+            children.insert( std::upper_bound( children.begin(), children.end(), std::make_pair( subid, 0U ),
+                                               []( const auto &a, const auto &b ) { return a.first < b.first; } ),
+                             { subid, next } );
+        }
+        node = next;
+    }
+
+    if ( m_Nodes[node].rule == NONE ) {
+        m_Nodes[node].rule = (uint32_t) m_Rules.size();
+        m_Rules.emplace_back();
+    }
+    Rule &entry = m_Rules[m_Nodes[node].rule];
+    entry.rule   = std::move( rule );
+    entry.action = action;
+    entry.hits.store( 0, std::memory_order_relaxed );
+    m_HasAllow = std::any_of( m_Rules.begin(), m_Rules.end(), []( const Rule &r ) { return r.action == ALLOW; } );
+}
+
+std::vector<TrapOidFilter::RuleStats> TrapOidFilter::GetRuleStats() const {
+    std::vector<RuleStats> stats;
+    for ( const Rule &r : m_Rules ) {
+        stats.push_back( { r.rule, r.action, r.hits.load( std::memory_order_relaxed ) } );
+    }
+    return stats;
+}
+
+TrapOidFilter::Action TrapOidFilter::Evaluate( std::span<const oid> trap_oid ) {
+    uint32_t node  = 0;
+    uint32_t match = m_Nodes[0].rule;
+    for ( oid subid : trap_oid ) {
+        node = child( node, subid );
+        if ( node == NONE ) {
+            break;
+        }
+        if ( m_Nodes[node].rule != NONE ) {
+            match = m_Nodes[node].rule;
+        }
+    }
+
+    if ( match == NONE ) {
+        m_Unmatched.fetch_add( 1, std::memory_order_relaxed );
+        return m_HasAllow ? DENY : ALLOW;
+    }
+    m_Rules[match].hits.fetch_add( 1, std::memory_order_relaxed );
+    return m_Rules[match].action;
+}
@@ -0,0 +1,74 @@
+#ifndef SNMP_SHARED_LIB_TRAP_FILTER_H
+#define SNMP_SHARED_LIB_TRAP_FILTER_H
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "snmp_pdu.h"
+
+/**
+ * Allow/deny rules on the snmpTrapOID.0 of traps, kept as a trie of OID
+ * prefixes so a trap is matched in one walk down its OID.
+ *
+ * The rule with the longest prefix of the trap OID decides.  A trap no
+ * rule matches is denied if there are any allow rules, allowed if not.
+ *
+ * The counts are atomic, so they can be read while another thread
+ * evaluates traps; rules are only added while none are evaluated.
+ */
+class TrapOidFilter {
+public:
+    enum Action { ALLOW, DENY };
+
+    struct RuleStats {
+        std::string rule;
+        Action      action;
+        uint64_t    hits;
+    };
+
+    TrapOidFilter();
+
+    /** Adds a rule for the OIDs under prefix, replacing one for the same prefix. */
+    void AddRule( std::span<const oid> prefix, Action action, std::string rule );
+
+    void Clear();
+
+    bool Empty() const { return m_Rules.empty(); }
+
+    /** Action for a trap with this snmpTrapOID.0; counts the match. */
+    Action Evaluate( std::span<const oid> trap_oid );
+
+    /** Traps matched by each rule, in the order the rules were added. */
+    std::vector<RuleStats> GetRuleStats() const;
+
+    /** Traps no rule matched. */
+    uint64_t GetUnmatched() const { return m_Unmatched.load( std::memory_order_relaxed ); }
+
+private:
+    static constexpr uint32_t NONE = UINT32_MAX; // no such node or rule
+
+    struct Node {
+        std::vector<std::pair<oid, uint32_t>> children; // subid, node index; sorted by subid
+        uint32_t                              rule = NONE;
+    };
+
+    uint32_t child( uint32_t node, oid subid ) const;
+
+    struct Rule {
+        std::string           rule;
+        Action                action;
+        std::atomic<uint64_t> hits{ 0 };
+    };
+
+    std::vector<Node>     m_Nodes; // m_Nodes[0] is the root
+    std::deque<Rule>      m_Rules; // a deque, as atomics cannot move
+    bool                  m_HasAllow = false;
+    std::atomic<uint64_t> m_Unmatched{ 0 };
+};
+
+#endif // SNMP_SHARED_LIB_TRAP_FILTER_H
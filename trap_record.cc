@@ -0,0 +1,49 @@
+#include "trap_record.h"
+#include "packet_parser.h"
+#include "mib_handler.h"
+
+static TrapVarBind::Value
+varbind_value( const netsnmp_variable_list *var ) {
+    switch ( var->type ) {
+        case ASN_INTEGER:
+            return *var->val.integer;
+        case ASN_COUNTER:
+        case ASN_GAUGE:
+        case ASN_TIMETICKS:
+        case ASN_UINTEGER:
+            return (uint32_t) *(u_long *) var->val.integer;
+        case ASN_COUNTER64:
+            return ( (uint64_t) var->val.counter64->high << 32 ) | ( var->val.counter64->low & 0xffffffff );
+        case ASN_OCTET_STR:
+        case ASN_IPADDRESS:
+        case ASN_OPAQUE:
+        case ASN_NSAP:
+        case ASN_BIT_STR:
+            return std::span<const u_char>( var->val.string, var->val_len );
+        case ASN_OBJECT_ID:
+            return std::span<const oid>( var->val.objid, var->val_len / sizeof( oid ) );
+        default:
+            return std::monostate();
+    }
+}
+
+TrapRecord::TrapRecord( std::unique_ptr<snmp_pdu> pdu ) : m_Pdu( std::move( pdu ) ) {
+    struct tree *head = get_tree_head();
+
+    for ( netsnmp_variable_list *var = m_Pdu->variables; var; var = var->next_variable ) {
+        TrapVarBind vb;
+        vb.name  = std::span<const oid>( var->name, var->name_length );
+        vb.type  = var->type;
+        vb.value = varbind_value( var );
+        vb.node  = get_tree( var->name, var->name_length, head );
+        if ( m_TrapOid.empty() && var->type == ASN_OBJECT_ID && var->name_length == OID_LENGTH( snmptrap_oid )
+             && !memcmp( var->name, snmptrap_oid, sizeof( snmptrap_oid ) ) ) {
+            m_TrapOid = std::get<std::span<const oid>>( vb.value );
+        }
+        m_VarBinds.push_back( vb );
+    }
+}
+
+TrapRecord::~TrapRecord() {
+    snmp_free_varbind( m_Pdu->variables );
+}
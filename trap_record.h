@@ -0,0 +1,66 @@
+#ifndef SNMP_SHARED_LIB_TRAP_RECORD_H
+#define SNMP_SHARED_LIB_TRAP_RECORD_H
+
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <variant>
+#include <vector>
+
+#include "snmp_pdu.h"
+
+struct tree;
+
+/**
+ * A variable binding of a decoded trap.
+ *
+ * name and the string and OID values point into the PDU owned by the
+ * TrapRecord, so they live as long as the record does.
+ */
+struct TrapVarBind {
+    typedef std::variant<std::monostate,          // NULL, noSuchObject, ...
+                         long,                    // INTEGER
+                         uint32_t,                // Counter32, Gauge32, TimeTicks, UInteger32
+                         uint64_t,                // Counter64
+                         std::span<const u_char>, // OCTET STRING, IpAddress, Opaque, BITS
+                         std::span<const oid>>    // OBJECT IDENTIFIER
+            Value;
+
+    std::span<const oid> name;
+    u_char               type;
+    Value                value;
+    const struct tree   *node; // MIB node the name falls under, NULL if unknown
+};
+
+/**
+ * A decoded SNMPv2c trap, for consumers that need fields of the trap
+ * rather than its text.
+ */
+class TrapRecord {
+public:
+    /** Takes ownership of a PDU filled in by parse_pdu(). */
+    explicit TrapRecord( std::unique_ptr<snmp_pdu> pdu );
+    ~TrapRecord();
+
+    TrapRecord( const TrapRecord & )            = delete;
+    TrapRecord &operator=( const TrapRecord & ) = delete;
+
+    long GetVersion() const { return m_Pdu->version; }
+
+    long GetRequestId() const { return m_Pdu->reqid; }
+
+    /** Value of snmpTrapOID.0, empty if the trap does not carry one. */
+    std::span<const oid> GetTrapOid() const { return m_TrapOid; }
+
+    const std::vector<TrapVarBind> &GetVarBinds() const { return m_VarBinds; }
+
+    /** The PDU itself, for the realloc_format_* formatters. */
+    snmp_pdu *GetPdu() const { return m_Pdu.get(); }
+
+private:
+    std::unique_ptr<snmp_pdu> m_Pdu;
+    std::span<const oid>      m_TrapOid;
+    std::vector<TrapVarBind>  m_VarBinds;
+};
+
+#endif // SNMP_SHARED_LIB_TRAP_RECORD_H
@@ -0,0 +1,200 @@
+#include "uring_receiver.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+
+#include <netinet/in.h>
+
+#if __has_include( <liburing.h> )
+#include <liburing.h>
+#define URING_RECEIVER_LIBURING 1
+#endif
+
+#ifdef URING_RECEIVER_LIBURING
+
+namespace {
+    constexpr int      BUFFER_GROUP     = 0;
+    constexpr unsigned BATCH            = 64; // completions taken per Wait
+    constexpr long     WAIT_TIMEOUT_SEC = 1;
+} // namespace
+
+struct UringReceiver::Ring {
+    io_uring              ring{};
+    bool                  ring_open = false;
+    io_uring_buf_ring    *buffers   = nullptr;
+    std::vector<u_char>   memory;
+    msghdr                msg{}; // only the name and control sizes are used
+    int                   fd       = -1;
+    bool                  armed    = false;
+    bool                  received = false; // a datagram came, so multishot recvmsg works
+    std::vector<uint16_t> in_use; // buffers of the last batch
+
+    /* Queues the multishot receive; it is submitted by the next wait. */
+    void arm() {
+        io_uring_sqe *sqe = io_uring_get_sqe( &ring );
+        if ( !sqe ) {
+            return;
+        }
+        io_uring_prep_recvmsg_multishot( sqe, fd, &msg, 0 );
+        sqe->flags |= IOSQE_BUFFER_SELECT;
+        sqe->buf_group = BUFFER_GROUP;
+        armed          = true;
+    }
+};
+
+UringReceiver::UringReceiver( unsigned buffers, size_t buffer_size, size_t control_size )
+        : m_Buffers( buffers ), m_BufferSize( buffer_size ), m_ControlSize( control_size ),
+          m_Ring( std::make_unique<Ring>() ) {}
+
+UringReceiver::~UringReceiver() {
+    if ( m_Ring->buffers ) {
+        io_uring_free_buf_ring( &m_Ring->ring, m_Ring->buffers, m_Buffers, BUFFER_GROUP );
+    }
+    if ( m_Ring->ring_open ) {
+        io_uring_queue_exit( &m_Ring->ring );
+    }
+}
+
+bool UringReceiver::Supported() {
+    return true;
+}
+
+size_t UringReceiver::Overhead( size_t control_size ) {
+    return sizeof( io_uring_recvmsg_out ) + sizeof( sockaddr_in6 ) + control_size;
+}
+
+int UringReceiver::Start( int fd ) {
+    Ring &r = *m_Ring;
+    if ( m_Buffers == 0 || m_Buffers > 32768 || ( m_Buffers & ( m_Buffers - 1 ) )
+         || m_BufferSize <= Overhead( m_ControlSize ) || m_BufferSize > UINT32_MAX ) {
+        return EINVAL;
+    }
+
+    /* each buffer completes once, and each multishot receive ends once more */
+    io_uring_params params{};
+    params.flags      = IORING_SETUP_CQSIZE;
+    params.cq_entries = 2 * m_Buffers;
+    int ret           = io_uring_queue_init_params( 8, &r.ring, &params );
+    if ( ret < 0 ) {
+        return -ret;
+    }
+    r.ring_open = true;
+
+    r.buffers = io_uring_setup_buf_ring( &r.ring, m_Buffers, BUFFER_GROUP, 0, &ret );
+    if ( !r.buffers ) {
+        return -ret;
+    }
+    r.memory.resize( m_Buffers * m_BufferSize );
+    for ( unsigned i = 0; i < m_Buffers; i++ ) {
+        io_uring_buf_ring_add( r.buffers, &r.memory[i * m_BufferSize], m_BufferSize, i,
+                               io_uring_buf_ring_mask( m_Buffers ), i );
+    }
+    io_uring_buf_ring_advance( r.buffers, m_Buffers );
+
+    r.msg.msg_namelen    = sizeof( sockaddr_in6 );
+    r.msg.msg_controllen = m_ControlSize;
+    r.fd                 = fd;
+    r.arm();
+    return 0;
+}
+
+int UringReceiver::Wait( std::vector<Datagram> &batch ) {
+    Ring &r = *m_Ring;
+    batch.clear();
+    if ( !r.armed ) {
+        r.arm();
+    }
+
+    io_uring_cqe *cqes[BATCH];
+    unsigned      count = io_uring_peek_batch_cqe( &r.ring, cqes, BATCH );
+    int           ret   = 0;
+    if ( count == 0 ) {
+        /*
+         * Shutting the socket down does not end a pending receive, so the
+         * wait is bounded for the caller to notice it is being stopped.
+         */
+        __kernel_timespec timeout{ WAIT_TIMEOUT_SEC, 0 };
+        ret   = io_uring_submit_and_wait_timeout( &r.ring, cqes, 1, &timeout, nullptr );
+        count = io_uring_peek_batch_cqe( &r.ring, cqes, BATCH );
+    } else if ( io_uring_sq_ready( &r.ring ) ) {
+        ret = io_uring_submit( &r.ring );
+    }
+    if ( ret < 0 && ret != -ETIME && ret != -EINTR ) {
+        return -ret;
+    }
+
+    int error = 0;
+    for ( unsigned i = 0; i < count; i++ ) {
+        const io_uring_cqe *cqe = cqes[i];
+        if ( !( cqe->flags & IORING_CQE_F_MORE ) ) {
+            r.armed = false;
+        }
+        if ( !( cqe->flags & IORING_CQE_F_BUFFER ) ) {
+            /* out of buffers is not an error: the receive is restarted once they are released */
+            if ( cqe->res == -EINVAL && !r.received ) {
+                /* kernels with buffer rings but before 6.0 reject the multishot flag only now */
+                error = EOPNOTSUPP;
+            } else if ( cqe->res < 0 && cqe->res != -ENOBUFS ) {
+                error = -cqe->res;
+            }
+            continue;
+        }
+        uint16_t id = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+        r.in_use.push_back( id );
+        r.received = true;
+        io_uring_recvmsg_out *out = io_uring_recvmsg_validate( &r.memory[id * m_BufferSize], cqe->res, &r.msg );
+        if ( !out ) {
+            continue;
+        }
+        batch.push_back( { (u_char *) io_uring_recvmsg_payload( out, &r.msg ),
+                           io_uring_recvmsg_payload_length( out, cqe->res, &r.msg ),
+                           (const sockaddr *) io_uring_recvmsg_name( out ),
+                           std::min<socklen_t>( out->namelen, r.msg.msg_namelen ),
+                           ( out->flags & MSG_TRUNC ) != 0,
+                           { (const u_char *) io_uring_recvmsg_name( out ) + r.msg.msg_namelen,
+                             std::min<size_t>( out->controllen, m_ControlSize ) } } );
+    }
+    io_uring_cq_advance( &r.ring, count );
+    return batch.empty() ? error : 0;
+}
+
+void UringReceiver::Release() {
+    Ring &r = *m_Ring;
+    for ( size_t i = 0; i < r.in_use.size(); i++ ) {
+        io_uring_buf_ring_add( r.buffers, &r.memory[r.in_use[i] * m_BufferSize], m_BufferSize, r.in_use[i],
+                               io_uring_buf_ring_mask( m_Buffers ), (int) i );
+    }
+    io_uring_buf_ring_advance( r.buffers, (int) r.in_use.size() );
+    r.in_use.clear();
+}
+
+#else // URING_RECEIVER_LIBURING
+
+struct UringReceiver::Ring {};
+
+UringReceiver::UringReceiver( unsigned buffers, size_t buffer_size, size_t control_size )
+        : m_Buffers( buffers ), m_BufferSize( buffer_size ), m_ControlSize( control_size ) {}
+
+UringReceiver::~UringReceiver() = default;
+
+bool UringReceiver::Supported() {
+    return false;
+}
+
+size_t UringReceiver::Overhead( size_t control_size ) {
+    return control_size;
+}
+
+int UringReceiver::Start( int ) {
+    return ENOSYS;
+}
+
+int UringReceiver::Wait( std::vector<Datagram> &batch ) {
+    batch.clear();
+    return ENOSYS;
+}
+
+void UringReceiver::Release() {}
+
+#endif // URING_RECEIVER_LIBURING
@@ -0,0 +1,74 @@
+#ifndef SNMP_SHARED_LIB_URING_RECEIVER_H
+#define SNMP_SHARED_LIB_URING_RECEIVER_H
+
+#include <cstddef>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/types.h>
+
+/**
+ * Receives datagrams from a UDP socket through io_uring.
+ *
+ * One multishot recvmsg keeps the kernel filling buffers from a ring of
+ * provided buffers, and the completions are reaped in batches.  While
+ * traffic keeps completions ready, Wait() takes them without a system
+ * call, and handing buffers back is a store into the shared ring.
+ *
+ * Built only when liburing is available; otherwise Supported() is false
+ * and Start() fails with ENOSYS.
+ */
+class UringReceiver {
+public:
+    struct Datagram {
+        u_char         *data;
+        size_t          length;    // bytes received into data
+        const sockaddr *source;
+        socklen_t       source_len;
+        bool            truncated; // longer than the buffer, only length bytes kept
+
+        std::span<const u_char> control; // ancillary data, as recvmsg would return it
+    };
+
+    /**
+     * buffers must be a power of two; each holds one datagram, its source
+     * address and up to control_size bytes of ancillary data.
+     */
+    UringReceiver( unsigned buffers, size_t buffer_size, size_t control_size = 0 );
+    ~UringReceiver();
+
+    UringReceiver( const UringReceiver & )            = delete;
+    UringReceiver &operator=( const UringReceiver & ) = delete;
+
+    static bool Supported();
+
+    /** Bytes of each buffer not left for the datagram. */
+    static size_t Overhead( size_t control_size );
+
+    /** Sets up the ring and starts receiving from fd.  Returns 0 or an errno. */
+    int Start( int fd );
+
+    /**
+     * Waits for datagrams and puts those completed into batch, which is
+     * empty if none came within a second or a signal arrived.  The data
+     * stays valid until Release().  Returns 0 or the errno of a failed
+     * receive; EOPNOTSUPP if the kernel rejected the multishot receive
+     * before anything came, which Start() cannot tell.
+     */
+    int Wait( std::vector<Datagram> &batch );
+
+    /** Hands the buffers of the last batch back to the kernel. */
+    void Release();
+
+private:
+    struct Ring;
+
+    unsigned              m_Buffers;
+    size_t                m_BufferSize;
+    size_t                m_ControlSize;
+    std::unique_ptr<Ring> m_Ring;
+};
+
+#endif // SNMP_SHARED_LIB_URING_RECEIVER_H
@@ -0,0 +1,98 @@
+#ifndef SNMP_SHARED_LIB_VARBIND_READER_H
+#define SNMP_SHARED_LIB_VARBIND_READER_H
+
+#include <cstdint>
+#include <span>
+
+#include "ber_reader.h"
+
+/**
+ * A variable binding as it appears in the packet, nothing decoded.
+ *
+ * name and value are whole BER elements, ready for a BerReader:
+ *
+ *   BerReader( vb.name ).ReadObjid( type, objid, objidlen );
+ *   BerReader( vb.value ).ReadInteger( type, number );
+ */
+struct VarBindView {
+    std::span<const uint8_t> name;     // OBJECT IDENTIFIER element
+    u_char                   type;     // ASN type of the value
+    std::span<const uint8_t> value;    // value element
+    std::span<const uint8_t> contents; // contents of the value element
+};
+
+/**
+ * Walks a variable-bindings list one varbind at a time, checking only
+ * the framing, so that consumers decode just the names and values they
+ * look at.  See parse_pdu_header() for getting at the list of a message.
+ *
+ *   VarBindReader reader( varbinds );
+ *   VarBindView   vb;
+ *   while ( reader.Next( vb ) ) {
+ *       ...
+ *   }
+ *   if ( reader.Error() >= 0 ) {
+ *       ... the list is malformed after the varbinds seen
+ *   }
+ *
+ * Errors found here are not counted in snmp_parse_error_count().
+ */
+class VarBindReader {
+public:
+    /** Over the contents of a variable-bindings SEQUENCE. */
+    explicit VarBindReader( std::span<const uint8_t> list ) : m_List( list ) {}
+
+    /**
+     * Moves to the next varbind.  Returns false at the end of the list or
+     * on a malformed varbind, in which case Error() is its ASN_ERR_* class.
+     */
+    bool Next( VarBindView &vb ) {
+        if ( m_Error >= 0 || m_List.Empty() ) {
+            return false;
+        }
+
+        /*
+         * VarBind ::= SEQUENCE { name OBJECT IDENTIFIER, value ANY }.  As in
+         * snmp_parse_var_op the next one starts right after the value.
+         */
+        BerReader                var_op = m_List;
+        std::span<const uint8_t> name_contents;
+        u_char                   name_type;
+        if ( !var_op.EnterSequence( ASN_SEQUENCE | ASN_CONSTRUCTOR ) ) {
+            return fail( var_op.Error() );
+        }
+        vb.name = var_op.Data();
+        if ( !var_op.ReadHeader( name_type, name_contents ) ) {
+            return fail( var_op.Error() );
+        }
+        if ( name_type != ASN_OBJECT_ID ) {
+            return fail( ASN_ERR_TYPE );
+        }
+        vb.name  = { vb.name.data(), name_contents.data() + name_contents.size() };
+        vb.value = var_op.Data();
+        if ( !var_op.ReadHeader( vb.type, vb.contents ) ) {
+            return fail( var_op.Error() );
+        }
+        vb.value = { vb.value.data(), vb.contents.data() + vb.contents.size() };
+
+        m_List.ContinueAt( var_op );
+        return true;
+    }
+
+    /** ASN_ERR_* class of the malformed varbind that ended the walk, or -1. */
+    int Error() const { return m_Error; }
+
+    /** Bytes of the list not yet walked. */
+    size_t Remaining() const { return m_List.Remaining(); }
+
+private:
+    bool fail( int err_class ) {
+        m_Error = err_class;
+        return false;
+    }
+
+    BerReader m_List;
+    int       m_Error = -1;
+};
+
+#endif // SNMP_SHARED_LIB_VARBIND_READER_H